@@ -0,0 +1,102 @@
+#include <assets.h>
+#include <cmath>
+#include <cstdio>
+#include <SFML/Graphics/Image.hpp>
+
+void Assets::buildTorus(int rings, int sides, vector<Vector3>& points, vector<int>& faces)
+{
+    const float pi = 3.1415927f;
+    const float major = 2.0f;
+    const float minor = 0.7f;
+
+    points.clear();
+    faces.clear();
+    for(int i = 0; i < rings; i++){
+        float u = 2.0f * pi * i / rings;
+        for(int j = 0; j < sides; j++){
+            float v = 2.0f * pi * j / sides;
+            float r = major + minor * cosf(v);
+            points.push_back(Vector3(r * cosf(u), minor * sinf(v), r * sinf(u)));
+        }
+    }
+
+    for(int i = 0; i < rings; i++){
+        int next = (i + 1) % rings;
+        for(int j = 0; j < sides; j++){
+            int nextSide = (j + 1) % sides;
+            int a = i * sides + j;
+            int b = next * sides + j;
+            int c = next * sides + nextSide;
+            int d = i * sides + nextSide;
+            faces.push_back(a);
+            faces.push_back(d);
+            faces.push_back(c);
+            faces.push_back(a);
+            faces.push_back(c);
+            faces.push_back(b);
+        }
+    }
+}
+
+void Assets::buildTorus(int rings, int sides, TriangleStore& mesh)
+{
+    vector<int> faces;
+    buildTorus(rings, sides, mesh.points, faces);
+    for(int i = 0; i < faces.size(); i += 3)
+        mesh.addTriangle(&faces[i], NULL, NULL);
+    mesh.setup();
+}
+
+bool Assets::writeTorus(string fileName, int rings, int sides)
+{
+    vector<Vector3> points;
+    vector<int> faces;
+    buildTorus(rings, sides, points, faces);
+
+    FILE* file = fopen(fileName.c_str(), "w");
+    if(!file)
+        return false;
+    for(int i = 0; i < points.size(); i++)
+        fprintf(file, "v %f %f %f\n", points[i].x, points[i].y, points[i].z);
+    for(int i = 0; i < faces.size(); i += 3)
+        fprintf(file, "f %d %d %d\n", faces[i] + 1, faces[i + 1] + 1, faces[i + 2] + 1);
+    fclose(file);
+    return true;
+}
+
+Vector3 Assets::randomPoint(Random& random, Vector3 Min, Vector3 Max)
+{
+    return Vector3(Min.x + random.nextFloat() * (Max.x - Min.x),
+                   Min.y + random.nextFloat() * (Max.y - Min.y),
+                   Min.z + random.nextFloat() * (Max.z - Min.z));
+}
+
+void Assets::makeRays(Random& random, int num, Vector3 center, float radius, Vector3 Min, Vector3 Max, vector<Ray>& rays)
+{
+    rays.resize(num);
+    for(int i = 0; i < num; i++){
+        Vector3 dir(0, 0, 0);
+        while(dir.getLength() < 0.01f || dir.getLength() > 1.0f)
+            dir = randomPoint(random, Vector3(-1, -1, -1), Vector3(1, 1, 1));
+        dir.normalize();
+
+        Vector3 origin = center + radius * dir;
+        Vector3 d = randomPoint(random, Min, Max) - origin;
+        d.normalize();
+        rays[i] = Ray(origin, d);
+    }
+}
+
+//black and white squares of the given size
+bool Assets::writeChecker(string fileName, int size, int square)
+{
+    sf::Image image;
+    image.create(size, size, sf::Color(0, 0, 0));
+    for(int y = 0; y < size; y++){
+        for(int x = 0; x < size; x++){
+            if((x / square + y / square) % 2 == 0)
+                image.setPixel(x, y, sf::Color(255, 255, 255));
+        }
+    }
+    return image.saveToFile(fileName);
+}
@@ -0,0 +1,39 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <string>
+#include <vector>
+
+#include <vector.h>
+#include <ray.h>
+#include <random.h>
+#include <triangleStore.h>
+
+using namespace std;
+
+//procedural inputs of the benchmarks, generated instead of stored so
+//the suite does not carry large binary files
+class Assets
+{
+    public:
+
+        //torus with rings * sides * 2 triangles around the y axis
+        static void buildTorus(int, int, vector<Vector3>&, vector<int>&);
+        static void buildTorus(int, int, TriangleStore&);
+        static bool writeTorus(string, int, int);
+
+        static bool writeChecker(string, int, int);
+
+        //rays from a sphere around a target aimed at points inside its bounds
+        static void makeRays(Random&, int, Vector3, float, Vector3, Vector3, vector<Ray>&);
+        static Vector3 randomPoint(Random&, Vector3, Vector3);
+
+        static const int torusRings = 384;
+        static const int torusSides = 192;
+
+    private:
+
+        Assets(void){}
+};
+
+#endif // ASSETS_H
@@ -0,0 +1,62 @@
+#-------------------------------------------------
+#
+# Reference scene renders and microbenchmarks of the
+# raytracer library, results are written as JSON
+#
+# run from this directory, -c is the correctness gate:
+#   raytracer-bench -o new.json -b baseline.json
+#   raytracer-bench -c
+#
+#-------------------------------------------------
+
+QT       -= core gui
+CONFIG   -= qt app_bundle
+CONFIG   += console c++11
+
+TARGET = raytracer-bench
+TEMPLATE = app
+
+RAYTRACER = $$PWD/../raytracer
+CLI = $$PWD/../cli
+
+DEPENDPATH += $$RAYTRACER $$CLI
+INCLUDEPATH += $$RAYTRACER $$CLI $$PWD
+
+win32{
+    INCLUDEPATH += $$quote(C:/Program Files (x86)\CodeBlocks\MinGW\x86_64-w64-mingw32\include)
+
+    CONFIG(debug, debug|release){
+        LIBS += -static -L$$RAYTRACER/bin/Debug -lraytracer
+        LIBS += -static -L"C:\Program"" ""Files"" ""(x86)\CodeBlocks\MinGW\x86_64-w64-mingw32\lib" -lsfml-graphics-d
+    }
+    else{
+        LIBS += -static -L$$RAYTRACER/bin/Release -lraytracer
+        LIBS += -static -L"C:\Program"" ""Files"" ""(x86)\CodeBlocks\MinGW\x86_64-w64-mingw32\lib" -lsfml-graphics
+    }
+}
+
+linux-g++{
+    CONFIG(debug, debug|release){
+        LIBS += -L$$RAYTRACER/bin/Debug -lraytracer
+    }
+    else{
+        LIBS += -L$$RAYTRACER/bin/Release -lraytracer
+    }
+    LIBS += -lsfml-graphics -pthread
+}
+
+SOURCES += main.cpp \
+    assets.cpp \
+    results.cpp \
+    sceneBench.cpp \
+    microBench.cpp \
+    check.cpp \
+    $$CLI/bufferImage.cpp \
+    $$CLI/consoleLogger.cpp
+
+HEADERS += \
+    assets.h \
+    results.h \
+    sceneBench.h \
+    microBench.h \
+    check.h
@@ -0,0 +1,197 @@
+#include <check.h>
+#include <assets.h>
+#include <sceneBench.h>
+#include <results.h>
+
+#include <cmath>
+#include <cstdlib>
+
+#include <raytracer.h>
+#include <triangleStore.h>
+#include <octree.h>
+#include <meshBVH.h>
+#include <packet.h>
+
+Check::Check(int t) : random(2, 0)
+{
+    threads = t;
+}
+
+//renders every reference scene and compares it to reference/<scene>.png,
+//with update set the renders replace the stored images instead
+bool Check::checkScenes(bool update)
+{
+    bool passed = true;
+    SceneBench bench(threads, 1);
+    if(!bench.setup()){
+        printf("could not write the benchmark mesh\n");
+        return false;
+    }
+
+    for(int i = 0; i < SceneBench::numScenes; i++){
+        string name = SceneBench::sceneNames[i];
+        string referenceFile = "reference/" + name + ".png";
+
+        Result r(name);
+        BufferImage* image = bench.render(name, r);
+        if(image == NULL){
+            printf("%-28s FAIL  scene did not load\n", name.c_str());
+            passed = false;
+            continue;
+        }
+
+        if(update){
+            bool saved = image->save(referenceFile);
+            printf("%-28s %s\n", name.c_str(), saved ? "reference written" : "FAIL  could not write reference");
+            passed = passed && saved;
+            delete image;
+            continue;
+        }
+
+        BufferImage reference(1, 1);
+        double psnr, bad;
+        if(!reference.load(referenceFile)){
+            printf("%-28s FAIL  missing %s\n", name.c_str(), referenceFile.c_str());
+            passed = false;
+        }
+        else if(!compareImages(*image, reference, psnr, bad)){
+            printf("%-28s FAIL  size differs from the reference\n", name.c_str());
+            passed = false;
+        }
+        else{
+            bool ok = psnr >= minPSNR && bad <= maxBadPixels;
+            printf("%-28s %s  psnr %6.2f dB, %.3f%% bad pixels\n", name.c_str(), ok ? "ok  " : "FAIL", psnr, bad * 100.0);
+            passed = passed && ok;
+        }
+        delete image;
+    }
+
+    return passed;
+}
+
+//PSNR over the color channels and the fraction of pixels where
+//a channel is off by more than badPixelError
+bool Check::compareImages(BufferImage& a, BufferImage& b, double& psnr, double& bad)
+{
+    if(a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight())
+        return false;
+
+    int pixels = a.getWidth() * a.getHeight();
+    unsigned char* pa = a.getPtr();
+    unsigned char* pb = b.getPtr();
+    double squared = 0.0;
+    int badCount = 0;
+    for(int i = 0; i < pixels; i++){
+        int worst = 0;
+        for(int k = 0; k < 3; k++){
+            int d = abs((int)pa[i * 4 + k] - (int)pb[i * 4 + k]);
+            squared += d * d;
+            worst = max(worst, d);
+        }
+        if(worst > badPixelError)
+            badCount++;
+    }
+
+    double mse = squared / (pixels * 3.0);
+    psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+    bad = (double)badCount / pixels;
+    return true;
+}
+
+bool Check::sameHit(bool hitA, float tA, bool hitB, float tB)
+{
+    if(hitA != hitB)
+        return false;
+    return !hitA || fabs(tA - tB) <= 1e-4f * max(1.0f, tA);
+}
+
+//the linear scan over the triangles is the reference, every structure
+//and the packet traversal must find the same closest hits
+bool Check::checkAccelerators(void)
+{
+    const int rings = 96;
+    const int sides = 48;
+
+    TriangleStore linearMesh, octreeMesh, bvhMesh;
+    Assets::buildTorus(rings, sides, linearMesh);
+    Assets::buildTorus(rings, sides, octreeMesh);
+    Assets::buildTorus(rings, sides, bvhMesh);
+
+    Octree octree(10, 10);
+    octree.createTree(&octreeMesh);
+    MeshBVH bvh(4);
+    bvh.createTree(&bvhMesh);
+
+    vector<Ray> rays;
+    Assets::makeRays(random, numRays, Vector3(0, 0, 0), 6.0f, Vector3(-2.7f, -0.7f, -2.7f), Vector3(2.7f, 0.7f, 2.7f), rays);
+
+    int octreeErrors = 0;
+    int bvhErrors = 0;
+    int occlusionErrors = 0;
+    int packetErrors = 0;
+    int hits = 0;
+    for(int i = 0; i < numRays; i++){
+        Hitpoint a, b, c;
+        a.t = FLT_MAX;
+        bool hitA = linearMesh.intersectRange(0, linearMesh.size(), rays[i], a);
+        b.t = FLT_MAX;
+        bool hitB = octree.intersectRay(rays[i], b);
+        c.t = FLT_MAX;
+        bool hitC = bvh.intersectRay(rays[i], c);
+
+        if(hitA)
+            hits++;
+        if(!sameHit(hitA, a.t, hitB, b.t))
+            octreeErrors++;
+        if(!sameHit(hitA, a.t, hitC, c.t))
+            bvhErrors++;
+
+        //the occlusion queries must agree on whether the closest hit lies
+        //within range, hits right at the range are too close to call
+        if(hitA && fabs(a.t - occlusionRange) < 1e-3f)
+            continue;
+        bool occluded = hitA && a.t <= occlusionRange;
+        if(octree.occludesRay(rays[i], occlusionRange) != occluded)
+            occlusionErrors++;
+        if(bvh.occludesRay(rays[i], occlusionRange) != occluded)
+            occlusionErrors++;
+    }
+
+    //packets of 64 rays from a shared origin, like a tile of camera rays
+    int packetRays = 0;
+    for(int p = 0; p < numRays / RayPacket::maxSize; p++){
+        RayPacket packet;
+        packet.size = RayPacket::maxSize;
+        Vector3 origin = Assets::randomPoint(random, Vector3(-6, 2, -6), Vector3(6, 4, -4));
+        Vector3 target = Assets::randomPoint(random, Vector3(-2.5f, -0.5f, -2.5f), Vector3(2.5f, 0.5f, 2.5f));
+        bool found[RayPacket::maxSize];
+        for(int i = 0; i < packet.size; i++){
+            Vector3 offset((i % 8) * 0.05f, (i / 8) * 0.05f, 0.0f);
+            Vector3 dir = target + offset - origin;
+            dir.normalize();
+            packet.rays[i] = Ray(origin, dir);
+            packet.active[i] = true;
+            packet.hits[i].t = FLT_MAX;
+            found[i] = false;
+        }
+        packet.setup();
+        bvh.intersectPacket(packet, found);
+
+        for(int i = 0; i < packet.size; i++){
+            Hitpoint a;
+            a.t = FLT_MAX;
+            bool hitA = linearMesh.intersectRange(0, linearMesh.size(), packet.rays[i], a);
+            if(!sameHit(hitA, a.t, found[i], packet.hits[i].t))
+                packetErrors++;
+            packetRays++;
+        }
+    }
+
+    printf("%-28s %d rays, %d hits\n", "accelerator rays", numRays, hits);
+    printf("%-28s %s  %d mismatches\n", "octree", octreeErrors == 0 ? "ok  " : "FAIL", octreeErrors);
+    printf("%-28s %s  %d mismatches\n", "meshBVH", bvhErrors == 0 ? "ok  " : "FAIL", bvhErrors);
+    printf("%-28s %s  %d mismatches in %d rays\n", "meshBVH packets", packetErrors == 0 ? "ok  " : "FAIL", packetErrors, packetRays);
+    printf("%-28s %s  %d mismatches\n", "occlusion", occlusionErrors == 0 ? "ok  " : "FAIL", occlusionErrors);
+
+    return octreeErrors == 0 && bvhErrors == 0 && packetErrors == 0 && occlusionErrors == 0;
+}
@@ -0,0 +1,45 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <string>
+#include <vector>
+
+#include <ray.h>
+#include <random.h>
+
+#include <bufferImage.h>
+
+using namespace std;
+
+//correctness gate for the optimized paths: renders the reference scenes
+//against stored images and compares the mesh structures hit for hit
+class Check
+{
+    public:
+
+        Check(int);
+
+        bool checkScenes(bool);
+        bool checkAccelerators(void);
+
+        //an image passes with at least this PSNR and
+        //no more than this fraction of clearly wrong pixels
+        static constexpr double minPSNR = 35.0;
+        static constexpr double maxBadPixels = 0.005;
+        static constexpr int badPixelError = 24;
+
+    private:
+
+        bool compareImages(BufferImage&, BufferImage&, double&, double&);
+        bool sameHit(bool, float, bool, float);
+
+        int threads;
+        Random random;
+
+        static const int numRays = 20000;
+
+        //shadow ray length, about half the random rays hit within it
+        static constexpr float occlusionRange = 6.0f;
+};
+
+#endif // CHECK_H
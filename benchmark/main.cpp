@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include <log.h>
+#include <cpu.h>
+
+#include <consoleLogger.h>
+#include <results.h>
+#include <sceneBench.h>
+#include <microBench.h>
+#include <check.h>
+
+using namespace std;
+
+struct Options
+{
+    string sceneDir;
+    string outputFile;
+    string baselineFile;
+    int threads;
+    int runs;
+    float minTime;
+    bool scenes;
+    bool micro;
+    bool check;
+    bool updateReferences;
+    bool verbose;
+};
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [options]\n", name);
+    fprintf(stderr, "  -d dir      directory of the reference scenes (default scenes)\n");
+    fprintf(stderr, "  -o file     JSON results (default results.json)\n");
+    fprintf(stderr, "  -b file     baseline JSON to compare against\n");
+    fprintf(stderr, "  -t threads  render threads (default: all cores)\n");
+    fprintf(stderr, "  -r runs     renders per scene, the fastest is kept (default 1)\n");
+    fprintf(stderr, "  -m seconds  time budget of every microbenchmark (default 0.5)\n");
+    fprintf(stderr, "  -s          scenes only\n");
+    fprintf(stderr, "  -u          microbenchmarks only\n");
+    fprintf(stderr, "  -c          check renders against scenes/reference and the\n");
+    fprintf(stderr, "              mesh structures against each other, no timing\n");
+    fprintf(stderr, "  -w          render new reference images\n");
+    fprintf(stderr, "  -v          print the library log\n");
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    options.sceneDir = "scenes";
+    options.outputFile = "results.json";
+    options.threads = max((int)thread::hardware_concurrency(), 1);
+    options.runs = 1;
+    options.minTime = 0.5f;
+    options.scenes = true;
+    options.micro = true;
+    options.check = false;
+    options.updateReferences = false;
+    options.verbose = false;
+
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(arg == "-s")
+            options.micro = false;
+        else if(arg == "-u")
+            options.scenes = false;
+        else if(arg == "-c")
+            options.check = true;
+        else if(arg == "-w")
+            options.updateReferences = true;
+        else if(arg == "-v")
+            options.verbose = true;
+        else if(arg == "-d" && hasValue)
+            options.sceneDir = argv[++i];
+        else if(arg == "-o" && hasValue)
+            options.outputFile = argv[++i];
+        else if(arg == "-b" && hasValue)
+            options.baselineFile = argv[++i];
+        else if(arg == "-t" && hasValue)
+            options.threads = atoi(argv[++i]);
+        else if(arg == "-r" && hasValue)
+            options.runs = atoi(argv[++i]);
+        else if(arg == "-m" && hasValue)
+            options.minTime = atof(argv[++i]);
+        else
+            return false;
+    }
+
+    return options.threads > 0 && options.runs > 0 && (options.scenes || options.micro);
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options)){
+        usage(argv[0]);
+        return 2;
+    }
+
+    ConsoleLogger logger(!options.verbose);
+    Log::setLogger(&logger);
+
+    Results baseline;
+    if(!options.baselineFile.empty() && !baseline.read(options.baselineFile)){
+        fprintf(stderr, "could not read baseline %s\n", options.baselineFile.c_str());
+        return 1;
+    }
+
+    //scene files refer to their meshes relative to the working directory
+    char cwd[4096];
+    if(getcwd(cwd, sizeof(cwd)) == NULL || chdir(options.sceneDir.c_str()) != 0){
+        fprintf(stderr, "could not enter %s\n", options.sceneDir.c_str());
+        return 1;
+    }
+
+    printf("%s kernels, %d threads\n", CPU::getName().c_str(), options.threads);
+
+    //the gate exits with an error when any render or structure differs
+    if(options.check || options.updateReferences){
+        Check check(options.threads);
+        bool passed = check.checkScenes(options.updateReferences);
+        if(!options.updateReferences)
+            passed = check.checkAccelerators() && passed;
+        printf("%s\n", passed ? "all checks passed" : "CHECK FAILED");
+        return passed ? 0 : 1;
+    }
+
+    Results results;
+    if(options.scenes){
+        SceneBench scenes(options.threads, options.runs);
+        if(!scenes.setup()){
+            fprintf(stderr, "could not write the benchmark mesh\n");
+            return 1;
+        }
+        scenes.runAll(results.scenes);
+    }
+    if(options.micro){
+        MicroBench micro(options.minTime);
+        micro.runAll(results.micro);
+    }
+
+    if(chdir(cwd) != 0 || !results.write(options.outputFile)){
+        fprintf(stderr, "could not write %s\n", options.outputFile.c_str());
+        return 1;
+    }
+
+    if(!options.baselineFile.empty())
+        results.compare(baseline);
+
+    return 0;
+}
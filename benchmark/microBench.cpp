@@ -0,0 +1,190 @@
+#include <microBench.h>
+#include <assets.h>
+
+#include <raytracer.h>
+#include <sphere.h>
+#include <triangle.h>
+#include <triangleStore.h>
+#include <octree.h>
+#include <meshBVH.h>
+#include <photonMap.h>
+#include <texture.h>
+#include <timer.h>
+
+MicroBench::MicroBench(float t) : random(1, 0)
+{
+    minTime = t;
+    sink = 0.0f;
+}
+
+void MicroBench::runAll(vector<Result>& results)
+{
+    triangle(results);
+    triangleStore(results);
+    accelerators(results);
+    sphere(results);
+    photonMap(results);
+    texture(results);
+}
+
+//doubles the loop count until one run takes a tenth of the time
+//budget, then keeps the fastest of the runs that fit in the budget
+template <class F>
+void MicroBench::measure(string name, F call, vector<Result>& results)
+{
+    long long iterations = 1;
+    Timer timer;
+    while(true){
+        timer.restart();
+        for(long long i = 0; i < iterations; i++)
+            call(i);
+        if(timer.elapsed() >= minTime * 0.1f || iterations >= (1LL << 40))
+            break;
+        iterations *= 2;
+    }
+
+    double best = 1e30;
+    Timer total;
+    for(int run = 0; run < 3 || total.elapsed() < minTime; run++){
+        timer.restart();
+        for(long long i = 0; i < iterations; i++)
+            call(i);
+        best = min(best, (double)timer.elapsed() * 1e9 / iterations);
+    }
+
+    Result r(name);
+    r.set("iterations", iterations);
+    r.set("nsPerOp", best);
+    results.push_back(r);
+    printf("%-28s %10.1f ns\n", name.c_str(), best);
+}
+
+void MicroBench::triangle(vector<Result>& results)
+{
+    Vector3 p1(-1, 0, 0), p2(1, 0, 0), p3(0, 1.5f, 0);
+    Triangle tri(&p1, &p2, &p3, false);
+    Assets::makeRays(random, numInputs, Vector3(0, 0.5f, 0), 4.0f, Vector3(-1.5f, -0.5f, -0.1f), Vector3(1.5f, 2.0f, 0.1f), rays);
+
+    measure("triangle.intersect", [&](long long i){
+        Hitpoint hit;
+        if(tri.intersectRay(rays[i & (numInputs - 1)], hit, Ray::SMALL, FLT_MAX))
+            sink = sink + hit.t;
+    }, results);
+}
+
+//one leaf worth of triangles through the widest kernel of the machine
+void MicroBench::triangleStore(vector<Result>& results)
+{
+    TriangleStore store;
+    Assets::buildTorus(4, 4, store);
+    Assets::makeRays(random, numInputs, Vector3(0, 0, 0), 6.0f, Vector3(-2.7f, -0.7f, -2.7f), Vector3(2.7f, 0.7f, 2.7f), rays);
+
+    measure("triangleStore.range8", [&](long long i){
+        Hitpoint hit;
+        hit.t = FLT_MAX;
+        if(store.intersectRange(0, 8, rays[i & (numInputs - 1)], hit))
+            sink = sink + hit.t;
+    }, results);
+}
+
+void MicroBench::accelerators(vector<Result>& results)
+{
+    TriangleStore octreeMesh;
+    Assets::buildTorus(Assets::torusRings, Assets::torusSides, octreeMesh);
+    Octree octree(10, 10);
+    octree.createTree(&octreeMesh);
+
+    TriangleStore bvhMesh;
+    Assets::buildTorus(Assets::torusRings, Assets::torusSides, bvhMesh);
+    MeshBVH bvh(4);
+    bvh.createTree(&bvhMesh);
+
+    Assets::makeRays(random, numInputs, Vector3(0, 0, 0), 6.0f, Vector3(-2.7f, -0.7f, -2.7f), Vector3(2.7f, 0.7f, 2.7f), rays);
+
+    measure("octree.intersectRay", [&](long long i){
+        Hitpoint hit;
+        hit.t = FLT_MAX;
+        if(octree.intersectRay(rays[i & (numInputs - 1)], hit))
+            sink = sink + hit.t;
+    }, results);
+
+    measure("meshBVH.intersectRay", [&](long long i){
+        Hitpoint hit;
+        hit.t = FLT_MAX;
+        if(bvh.intersectRay(rays[i & (numInputs - 1)], hit))
+            sink = sink + hit.t;
+    }, results);
+
+    //shadow queries without a light in the way, any hit ends them
+    measure("octree.occludesRay", [&](long long i){
+        if(octree.occludesRay(rays[i & (numInputs - 1)], FLT_MAX))
+            sink = sink + 1.0f;
+    }, results);
+
+    measure("meshBVH.occludesRay", [&](long long i){
+        if(bvh.occludesRay(rays[i & (numInputs - 1)], FLT_MAX))
+            sink = sink + 1.0f;
+    }, results);
+}
+
+void MicroBench::sphere(vector<Result>& results)
+{
+    Sphere s(Vector3(0, 0, 0), 1.0f);
+    Assets::makeRays(random, numInputs, Vector3(0, 0, 0), 4.0f, Vector3(-1.5f, -1.5f, -1.5f), Vector3(1.5f, 1.5f, 1.5f), rays);
+
+    measure("sphere.intersect", [&](long long i){
+        Hitpoint hit;
+        if(s.intersectRay(rays[i & (numInputs - 1)], hit, Ray::SMALL, FLT_MAX))
+            sink = sink + hit.t;
+    }, results);
+}
+
+void MicroBench::photonMap(vector<Result>& results)
+{
+    PhotonMap map;
+    Vector3 up(0, 1, 0);
+    for(int i = 0; i < 100000; i++){
+        Vector3 pos = Assets::randomPoint(random, Vector3(0, 0, 0), Vector3(1, 1, 1));
+        Vector3 power(1, 1, 1);
+        Photon p(pos, up, power);
+        p.normal = up;
+        map.store(p);
+    }
+    map.setup();
+
+    vector<Vector3> queries(numInputs);
+    for(int i = 0; i < numInputs; i++)
+        queries[i] = Assets::randomPoint(random, Vector3(0, 0, 0), Vector3(1, 1, 1));
+
+    vector<Photon*> found;
+    measure("photonMap.nearestN", [&](long long i){
+        found.clear();
+        map.nearestN(queries[i & (numInputs - 1)], up, found, 50, 0.1f);
+        sink = sink + found.size();
+    }, results);
+}
+
+void MicroBench::texture(vector<Result>& results)
+{
+    if(!Assets::writeChecker("checker.png", 512, 16)){
+        printf("texture.sample skipped, could not write checker.png\n");
+        return;
+    }
+    Texture* tex = Texture::loadTexture("checker.png", Texture::BILINEAR, Texture::REPEAT);
+    if(tex == NULL){
+        printf("texture.sample skipped, could not load checker.png\n");
+        return;
+    }
+
+    vector<float> coords(numInputs * 2);
+    for(int i = 0; i < numInputs * 2; i++)
+        coords[i] = random.nextFloat() * 4.0f;
+
+    measure("texture.sample", [&](long long i){
+        int k = (i & (numInputs - 1)) * 2;
+        Vector3 c = tex->sampleTexture(coords[k], coords[k + 1]);
+        sink = sink + c.x;
+    }, results);
+
+    delete tex;
+}
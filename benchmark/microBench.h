@@ -0,0 +1,47 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <string>
+#include <vector>
+
+#include <ray.h>
+#include <random.h>
+
+#include <results.h>
+
+using namespace std;
+
+//timed loops over single library calls with fixed random inputs,
+//every case reports the fastest of several runs in ns per call
+class MicroBench
+{
+    public:
+
+        MicroBench(float);
+
+        void runAll(vector<Result>&);
+
+    private:
+
+        template <class F>
+        void measure(string, F, vector<Result>&);
+
+        void triangle(vector<Result>&);
+        void triangleStore(vector<Result>&);
+        void accelerators(vector<Result>&);
+        void sphere(vector<Result>&);
+        void photonMap(vector<Result>&);
+        void texture(vector<Result>&);
+
+        float minTime;
+        Random random;
+
+        //the inputs are cycled so every call sees a different ray
+        static const int numInputs = 4096;
+        vector<Ray> rays;
+
+        //keeps the compiler from dropping the measured calls
+        volatile float sink;
+};
+
+#endif // MICROBENCH_H
@@ -0,0 +1,157 @@
+#include <results.h>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+Result::Result(string n)
+{
+    name = n;
+}
+
+void Result::set(string key, double value)
+{
+    for(int i = 0; i < keys.size(); i++){
+        if(keys[i] == key){
+            values[i] = value;
+            return;
+        }
+    }
+    keys.push_back(key);
+    values.push_back(value);
+}
+
+bool Result::get(string key, double& value) const
+{
+    for(int i = 0; i < keys.size(); i++){
+        if(keys[i] == key){
+            value = values[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Results::write(string fileName)
+{
+    FILE* file = fopen(fileName.c_str(), "w");
+    if(!file)
+        return false;
+
+    fprintf(file, "{\n");
+    writeGroup(file, "scenes", scenes, false);
+    writeGroup(file, "micro", micro, true);
+    fprintf(file, "}\n");
+
+    fclose(file);
+    return true;
+}
+
+void Results::writeGroup(FILE* file, const char* group, vector<Result>& results, bool last)
+{
+    fprintf(file, "  \"%s\": [\n", group);
+    for(int i = 0; i < results.size(); i++){
+        Result& r = results[i];
+        fprintf(file, "    {\"name\": \"%s\"", r.name.c_str());
+        for(int k = 0; k < r.keys.size(); k++)
+            fprintf(file, ", \"%s\": %.9g", r.keys[k].c_str(), r.values[k]);
+        fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]%s\n", last ? "" : ",");
+}
+
+//reads back the files written above, every object in a group
+//is a name and numbers, anything else is skipped
+bool Results::read(string fileName)
+{
+    ifstream file(fileName.c_str());
+    if(!file)
+        return false;
+    stringstream buffer;
+    buffer<<file.rdbuf();
+    string text = buffer.str();
+
+    scenes.clear();
+    micro.clear();
+
+    vector<Result>* group = NULL;
+    Result* current = NULL;
+    string key;
+    int i = 0;
+    while(i < text.size()){
+        char c = text[i];
+        if(c == '"'){
+            int end = text.find('"', i + 1);
+            if(end == string::npos)
+                return false;
+            string token = text.substr(i + 1, end - i - 1);
+            i = end + 1;
+
+            if(current && key == "name"){
+                current->name = token;
+                key.clear();
+            }
+            else if(current == NULL && token == "scenes")
+                group = &scenes;
+            else if(current == NULL && token == "micro")
+                group = &micro;
+            else
+                key = token;
+        }
+        else if(c == '{' && group){
+            group->push_back(Result(""));
+            current = &group->back();
+            i++;
+        }
+        else if(c == '}'){
+            current = NULL;
+            i++;
+        }
+        else if(current && (c == '-' || isdigit(c))){
+            char* end;
+            double value = strtod(text.c_str() + i, &end);
+            current->set(key, value);
+            i = end - text.c_str();
+        }
+        else
+            i++;
+    }
+
+    return true;
+}
+
+const Result* Results::find(vector<Result>& results, string name)
+{
+    for(int i = 0; i < results.size(); i++){
+        if(results[i].name == name)
+            return &results[i];
+    }
+    return NULL;
+}
+
+//prints the change of every result against the baseline,
+//lower is better for both render time and time per operation
+void Results::compare(Results& baseline)
+{
+    compareGroup("scene", scenes, baseline.scenes, "render");
+    compareGroup("micro", micro, baseline.micro, "nsPerOp");
+}
+
+void Results::compareGroup(const char* title, vector<Result>& current, vector<Result>& base, const char* key)
+{
+    if(current.empty())
+        return;
+
+    printf("%-28s %12s %12s %9s\n", title, "baseline", "current", "change");
+    for(int i = 0; i < current.size(); i++){
+        double now, before;
+        const Result* old = find(base, current[i].name);
+        if(!current[i].get(key, now))
+            continue;
+        if(old == NULL || !old->get(key, before) || before <= 0.0){
+            printf("%-28s %12s %12.4g %9s\n", current[i].name.c_str(), "-", now, "new");
+            continue;
+        }
+        printf("%-28s %12.4g %12.4g %+8.1f%%\n", current[i].name.c_str(), before, now, (now / before - 1.0) * 100.0);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//one named measurement, a flat set of numeric values
+struct Result
+{
+    string name;
+    vector<string> keys;
+    vector<double> values;
+
+    Result(string);
+
+    void set(string, double);
+    bool get(string, double&) const;
+};
+
+//results of a benchmark run, stored as
+//{"scenes": [...], "micro": [...]}
+class Results
+{
+    public:
+
+        vector<Result> scenes;
+        vector<Result> micro;
+
+        bool write(string);
+        bool read(string);
+
+        void compare(Results&);
+
+    private:
+
+        void writeGroup(FILE*, const char*, vector<Result>&, bool);
+        void compareGroup(const char*, vector<Result>&, vector<Result>&, const char*);
+        const Result* find(vector<Result>&, string);
+};
+
+#endif // RESULTS_H
@@ -0,0 +1,87 @@
+#include <sceneBench.h>
+#include <assets.h>
+#include <fstream>
+
+#include <raytracer.h>
+#include <manager.h>
+#include <timer.h>
+
+const char* SceneBench::sceneNames[] = {"spheres", "mesh", "glossy", "photon", "area", "lights"};
+const int SceneBench::numScenes = 6;
+
+SceneBench::SceneBench(int t, int r)
+{
+    threads = t;
+    runs = r;
+}
+
+//writes the generated mesh the mesh scene refers to
+bool SceneBench::setup(void)
+{
+    ifstream existing("torus.obj");
+    if(existing)
+        return true;
+    return Assets::writeTorus("torus.obj", Assets::torusRings, Assets::torusSides);
+}
+
+void SceneBench::runAll(vector<Result>& results)
+{
+    for(int i = 0; i < numScenes; i++){
+        Result r(sceneNames[i]);
+        BufferImage* image = render(sceneNames[i], r);
+        if(image == NULL){
+            printf("%-28s failed to load\n", sceneNames[i]);
+            continue;
+        }
+        delete image;
+
+        double render, rate;
+        r.get("render", render);
+        r.get("raysPerSecond", rate);
+        printf("%-28s %10.3f s %12.0f rays/s\n", sceneNames[i], render, rate);
+        results.push_back(r);
+    }
+}
+
+//renders the scene the given number of times and keeps the fastest
+//render, the image of the last run is returned
+BufferImage* SceneBench::render(string name, Result& result)
+{
+    BufferImage* image = NULL;
+    double bestRender = 1e30;
+
+    for(int run = 0; run < runs; run++){
+        Timer total;
+        Raytracer R;
+        if(!R.loadScene(name + ".scene")){
+            delete image;
+            return NULL;
+        }
+
+        delete image;
+        image = new BufferImage(R.getWidth(), R.getHeight());
+
+        Timer timer;
+        Manager manager(threads, 4, image, &R);
+        manager.Render();
+        float renderTime = timer.elapsed();
+        if(renderTime >= bestRender)
+            continue;
+        bestRender = renderTime;
+
+        SetupTimes& setup = R.getSetupTimes();
+        long long rays = manager.getRayCount();
+        result.set("width", R.getWidth());
+        result.set("height", R.getHeight());
+        result.set("threads", threads);
+        result.set("parse", setup.parse);
+        result.set("build", setup.build);
+        result.set("photon", setup.photon);
+        result.set("render", renderTime);
+        result.set("total", total.elapsed());
+        result.set("cameraRays", rays);
+        result.set("raysPerSecond", renderTime > 0.0f ? rays / renderTime : 0.0);
+    }
+
+    return image;
+}
@@ -0,0 +1,33 @@
+#ifndef SCENEBENCH_H
+#define SCENEBENCH_H
+
+#include <string>
+#include <vector>
+
+#include <bufferImage.h>
+#include <results.h>
+
+using namespace std;
+
+//renders the reference scenes end to end, scene files are looked
+//up in the current directory and meshes are generated next to them
+class SceneBench
+{
+    public:
+
+        SceneBench(int, int);
+
+        bool setup(void);
+        void runAll(vector<Result>&);
+        BufferImage* render(string, Result&);
+
+        static const char* sceneNames[];
+        static const int numScenes;
+
+    private:
+
+        int threads;
+        int runs;
+};
+
+#endif // SCENEBENCH_H
@@ -0,0 +1,67 @@
+#include <bufferImage.h>
+#include <SFML/Graphics/Image.hpp>
+
+BufferImage::BufferImage(int w, int h)
+{
+    width = w;
+    height = h;
+    data.resize(w * h, pixel(Vector3(0, 0, 0)));
+}
+
+void BufferImage::setPixel(int x, int y, Vector3& color)
+{
+    data[y * width + x] = pixel(color);
+}
+
+Vector3 BufferImage::getPixel(int x, int y)
+{
+    pixel p = data[y * width + x];
+    return Vector3(p.r / 255.0f, p.g / 255.0f, p.b / 255.0f);
+}
+
+unsigned char* BufferImage::getPtr(void)
+{
+    return (unsigned char*)&data[0];
+}
+
+int BufferImage::getWidth(void)
+{
+    return width;
+}
+
+int BufferImage::getHeight(void)
+{
+    return height;
+}
+
+//replaces the contents and size with the image in the file
+bool BufferImage::load(std::string fileName)
+{
+    sf::Image image;
+    if(!image.loadFromFile(fileName))
+        return false;
+
+    sf::Vector2u size = image.getSize();
+    width = size.x;
+    height = size.y;
+    data.resize(width * height);
+    for(int y = 0; y < height; y++){
+        for(int x = 0; x < width; x++){
+            sf::Color c = image.getPixel(x, y);
+            pixel& p = data[y * width + x];
+            p.r = c.r;
+            p.g = c.g;
+            p.b = c.b;
+            p.a = 255;
+        }
+    }
+    return true;
+}
+
+//the format follows the file extension
+bool BufferImage::save(std::string fileName)
+{
+    sf::Image image;
+    image.create(width, height, getPtr());
+    return image.saveToFile(fileName);
+}
@@ -0,0 +1,51 @@
+#ifndef BUFFERIMAGE_H
+#define BUFFERIMAGE_H
+
+#include <string>
+#include <vector>
+
+#include <image.h>
+
+//plain RGBA image in memory, written out through SFML
+class BufferImage : public Image
+{
+    public:
+
+        BufferImage(int, int);
+        void setPixel(int, int, Vector3&);
+        Vector3 getPixel(int, int);
+        unsigned char* getPtr(void);
+
+        int getWidth(void);
+        int getHeight(void);
+
+        bool save(std::string);
+        bool load(std::string);
+
+    private:
+
+        //used to store an individual pixel
+        struct pixel
+        {
+            unsigned char r, g, b, a;
+
+            pixel(){}
+
+            //creates a colored pixel and clamps values with rounding
+            pixel(Vector3 color)
+            {
+                color *= 255.0f;
+                r = max(min((int)(color.x + 0.5f), 255), 0);
+                g = max(min((int)(color.y + 0.5f), 255), 0);
+                b = max(min((int)(color.z + 0.5f), 255), 0);
+                a = 255;
+            }
+        };
+
+        int width;
+        int height;
+
+        std::vector<pixel> data;
+};
+
+#endif // BUFFERIMAGE_H
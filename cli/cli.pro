@@ -0,0 +1,49 @@
+#-------------------------------------------------
+#
+# Headless renderer for machines without a display,
+# only needs the raytracer library and SFML
+#
+#-------------------------------------------------
+
+QT       -= core gui
+CONFIG   -= qt app_bundle
+CONFIG   += console c++11
+
+TARGET = raytracer-cli
+TEMPLATE = app
+
+RAYTRACER = $$PWD/../raytracer
+
+DEPENDPATH += $$RAYTRACER
+INCLUDEPATH += $$RAYTRACER
+
+win32{
+    INCLUDEPATH += $$quote(C:/Program Files (x86)\CodeBlocks\MinGW\x86_64-w64-mingw32\include)
+
+    CONFIG(debug, debug|release){
+        LIBS += -static -L$$RAYTRACER/bin/Debug -lraytracer
+        LIBS += -static -L"C:\Program"" ""Files"" ""(x86)\CodeBlocks\MinGW\x86_64-w64-mingw32\lib" -lsfml-graphics-d
+    }
+    else{
+        LIBS += -static -L$$RAYTRACER/bin/Release -lraytracer
+        LIBS += -static -L"C:\Program"" ""Files"" ""(x86)\CodeBlocks\MinGW\x86_64-w64-mingw32\lib" -lsfml-graphics
+    }
+}
+
+linux-g++{
+    CONFIG(debug, debug|release){
+        LIBS += -L$$RAYTRACER/bin/Debug -lraytracer
+    }
+    else{
+        LIBS += -L$$RAYTRACER/bin/Release -lraytracer
+    }
+    LIBS += -lsfml-graphics -pthread
+}
+
+SOURCES += main.cpp \
+    bufferImage.cpp \
+    consoleLogger.cpp
+
+HEADERS += \
+    bufferImage.h \
+    consoleLogger.h
@@ -0,0 +1,19 @@
+#include <consoleLogger.h>
+#include <iostream>
+
+ConsoleLogger::ConsoleLogger(bool q)
+{
+    quiet = q;
+}
+
+void ConsoleLogger::write(std::string message)
+{
+    if(!quiet)
+        std::cerr<<message;
+}
+
+void ConsoleLogger::writeLine(std::string message)
+{
+    if(!quiet)
+        std::cerr<<message<<std::endl;
+}
@@ -0,0 +1,22 @@
+#ifndef CONSOLELOGGER_H
+#define CONSOLELOGGER_H
+
+#include <logger.h>
+
+//sends the library log to standard error so the
+//report on standard output stays easy to parse
+class ConsoleLogger : public Logger
+{
+    public:
+
+        ConsoleLogger(bool);
+
+        void write(std::string);
+        void writeLine(std::string);
+
+    private:
+
+        bool quiet;
+};
+
+#endif // CONSOLELOGGER_H
@@ -0,0 +1,172 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <raytracer.h>
+#include <manager.h>
+#include <timer.h>
+#include <trace.h>
+#include <costBuffer.h>
+
+#include <bufferImage.h>
+#include <consoleLogger.h>
+
+using namespace std;
+
+struct Options
+{
+    string sceneFile;
+    string outputFile;
+    string traceFile;
+    string heatmapFile;
+    CostBuffer::Mode costMode;
+    int threads;
+    int blocks;
+    int packetSize;
+    bool quiet;
+};
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [options] scene\n", name);
+    fprintf(stderr, "  -o file     output image, png/bmp/tga/jpg (default image.png)\n");
+    fprintf(stderr, "  -t threads  render threads (default: all cores)\n");
+    fprintf(stderr, "  -b blocks   blocks per side of the initial tile grid (default 4)\n");
+    fprintf(stderr, "  -p size     packet tile size 1-8, overrides the scene\n");
+    fprintf(stderr, "  -T file     write a Chrome trace of the load and render phases\n");
+    fprintf(stderr, "  -H file     write a heatmap of the render cost per pixel, the raw\n");
+    fprintf(stderr, "              costs go to the same name with a .pfm extension\n");
+    fprintf(stderr, "  -C cost     heatmap cost, time or rays (rays need a RAY_STATS build)\n");
+    fprintf(stderr, "  -q          do not print the library log\n");
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    options.outputFile = "image.png";
+    options.threads = max((int)thread::hardware_concurrency(), 1);
+    options.blocks = 4;
+    options.packetSize = 0;
+    options.quiet = false;
+    options.costMode = CostBuffer::TIME;
+
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if(arg == "-q")
+            options.quiet = true;
+        else if(arg == "-o" && hasValue)
+            options.outputFile = argv[++i];
+        else if(arg == "-t" && hasValue)
+            options.threads = atoi(argv[++i]);
+        else if(arg == "-b" && hasValue)
+            options.blocks = atoi(argv[++i]);
+        else if(arg == "-p" && hasValue)
+            options.packetSize = atoi(argv[++i]);
+        else if(arg == "-T" && hasValue)
+            options.traceFile = argv[++i];
+        else if(arg == "-H" && hasValue)
+            options.heatmapFile = argv[++i];
+        else if(arg == "-C" && hasValue){
+            string cost = argv[++i];
+            if(cost == "rays")
+                options.costMode = CostBuffer::RAYS;
+            else if(cost != "time")
+                return false;
+        }
+        else if(arg[0] != '-' && options.sceneFile.empty())
+            options.sceneFile = arg;
+        else
+            return false;
+    }
+
+    return !options.sceneFile.empty() && options.threads > 0 && options.blocks > 0;
+}
+
+//the heatmap in the given format and the raw costs next to it
+static bool writeCosts(CostBuffer& costs, const string& fileName)
+{
+    BufferImage heatmap(costs.getWidth(), costs.getHeight());
+    costs.writeHeatmap(&heatmap);
+    if(!heatmap.save(fileName)){
+        fprintf(stderr, "could not write %s\n", fileName.c_str());
+        return false;
+    }
+
+    string rawFile = fileName.substr(0, fileName.find_last_of('.')) + ".pfm";
+    if(!costs.writeRaw(rawFile)){
+        fprintf(stderr, "could not write %s\n", rawFile.c_str());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options)){
+        usage(argv[0]);
+        return 2;
+    }
+
+    ConsoleLogger logger(options.quiet);
+    Log::setLogger(&logger);
+
+    if(!options.traceFile.empty()){
+        Trace::start();
+        Trace::setThreadName("main");
+    }
+
+    Timer total;
+    Raytracer R;
+    if(!R.loadScene(options.sceneFile)){
+        fprintf(stderr, "could not load scene %s\n", options.sceneFile.c_str());
+        return 1;
+    }
+    if(options.packetSize > 0)
+        R.setPacketSize(options.packetSize);
+
+    BufferImage image(R.getWidth(), R.getHeight());
+
+    CostBuffer costs(R.getWidth(), R.getHeight(), options.costMode);
+
+    Timer timer;
+    Manager manager(options.threads, options.blocks, &image, &R);
+    if(!options.heatmapFile.empty())
+        manager.setCostBuffer(&costs);
+    manager.Render();
+    float renderTime = timer.elapsed();
+
+    if(!options.traceFile.empty()){
+        Trace::stop();
+        if(!Trace::write(options.traceFile))
+            fprintf(stderr, "could not write %s\n", options.traceFile.c_str());
+    }
+
+    if(!image.save(options.outputFile)){
+        fprintf(stderr, "could not write %s\n", options.outputFile.c_str());
+        return 1;
+    }
+
+    if(!options.heatmapFile.empty() && !writeCosts(costs, options.heatmapFile))
+        return 1;
+
+    SetupTimes& setup = R.getSetupTimes();
+    long long rays = manager.getRayCount();
+
+    printf("scene:        %s\n", options.sceneFile.c_str());
+    printf("resolution:   %dx%d\n", R.getWidth(), R.getHeight());
+    printf("threads:      %d\n", options.threads);
+    printf("packet size:  %d\n", R.getPacketSize());
+    printf("parse:        %.3f s\n", setup.parse);
+    printf("build:        %.3f s\n", setup.build);
+    printf("photon:       %.3f s\n", setup.photon);
+    printf("render:       %.3f s\n", renderTime);
+    printf("total:        %.3f s\n", total.elapsed());
+    printf("camera rays:  %lld\n", rays);
+    printf("rays/second:  %.0f\n", renderTime > 0.0f ? rays / renderTime : 0.0);
+
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include "accelerator.h"
+#include "packet.h"
+
+//structures without an any hit traversal search for the closest hit
+bool Accelerator::occludesRay(Ray& ray, float range)
+{
+    Hitpoint hit;
+    hit.t = range;
+    return intersectRay(ray, hit);
+}
+
+//structures without a packet traversal trace the rays one at a time
+void Accelerator::intersectPacket(RayPacket& packet, bool* found)
+{
+    Hitpoint hit;
+    for(int i = 0; i < packet.size; i++){
+        if(!packet.active[i])
+            continue;
+        hit.t = packet.hits[i].t;
+        if(intersectRay(packet.rays[i], hit)){
+            packet.hits[i] = hit;
+            found[i] = true;
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef ACCELERATOR_H_INCLUDED
+#define ACCELERATOR_H_INCLUDED
+
+#include <vector>
+#include "ray.h"
+
+class TriangleStore;
+struct Hitpoint;
+struct RayPacket;
+
+//common interface of the mesh acceleration structures
+class Accelerator
+{
+    public:
+
+        enum Type {NONE, OCTREE, SAH};
+
+        virtual ~Accelerator(){}
+
+        virtual void createTree(TriangleStore*) =0;
+        //closest hit nearer than hit.t, which the caller sets
+        virtual bool intersectRay(Ray&, Hitpoint&) =0;
+        virtual bool occludesRay(Ray&, float);
+        virtual void intersectPacket(RayPacket&, bool*);
+
+        virtual int getNodeCount(void) =0;
+        virtual size_t getMemoryUsage(void) =0;
+};
+
+#endif // ACCELERATOR_H_INCLUDED
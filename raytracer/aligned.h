@@ -0,0 +1,71 @@
+#ifndef ALIGNED_H_INCLUDED
+#define ALIGNED_H_INCLUDED
+
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+//fixed size array whose storage starts on a cache line,
+//used for the flattened acceleration structure nodes
+template <class T>
+class AlignedArray
+{
+    public:
+
+        static const int cacheLine = 64;
+
+        AlignedArray(void) : data(NULL), block(NULL), num(0) {}
+
+        ~AlignedArray(void)
+        {
+            free(block);
+        }
+
+        //replaces the contents with a copy of the vector
+        void assign(const std::vector<T>& source)
+        {
+            free(block);
+            data = NULL;
+            block = NULL;
+            num = source.size();
+            if(num == 0)
+                return;
+
+            block = malloc(num * sizeof(T) + cacheLine);
+            uintptr_t address = ((uintptr_t)block + cacheLine - 1) & ~(uintptr_t)(cacheLine - 1);
+            data = (T*)address;
+            memcpy(data, &source[0], num * sizeof(T));
+        }
+
+        T& operator[] (int i)
+        {
+            return data[i];
+        }
+
+        T* ptr(void)
+        {
+            return data;
+        }
+
+        int size(void)
+        {
+            return num;
+        }
+
+        size_t getMemoryUsage(void)
+        {
+            return num * sizeof(T);
+        }
+
+    private:
+
+        AlignedArray(const AlignedArray&);
+        AlignedArray& operator= (const AlignedArray&);
+
+        T* data;
+        void* block;
+        int num;
+};
+
+#endif // ALIGNED_H_INCLUDED
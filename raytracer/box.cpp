@@ -8,11 +8,11 @@ Box::Box(Vector3 bound1, Vector3 bound2)
     maxCorner = bound2;
 }
 
-bool Box::Intersection(Ray& ray, Hitpoint& h)
+bool Box::Intersection(Ray& ray, Hitpoint& h, float tMin, float tMax)
 {
-    //min and max times in overlap interval
-    float tMin = 0.0f;
-    float tMax = FLT_MAX;
+    //the slabs clip the given interval, a ray starting inside the
+    //box never moves its minimum and does not hit
+    float start = tMin;
 
     //intersection point and direction
     Vector3 P = ray.origin;
@@ -164,6 +164,9 @@ bool Box::Intersection(Ray& ray, Hitpoint& h)
             tMax = zMax;
     }
 
+    if(tMin <= start)
+        return false;
+
     h.t = tMin;
     return true;
 }
@@ -187,6 +190,13 @@ Vector3 Box::getNormal(Ray& ray)
     }
 }
 
+bool Box::getBounds(Vector3& minBound, Vector3& maxBound)
+{
+    minBound = minCorner;
+    maxBound = maxCorner;
+    return true;
+}
+
 void Box::getUV(Vector3& point, Ray& ray, float& u, float& v)
 {
     switch((SIDE_ID)ray.cacheFloat1){
@@ -0,0 +1,287 @@
+#include "bvh.h"
+#include <algorithm>
+#include <thread>
+
+BVHPrimitive::BVHPrimitive(Vector3& minBound, Vector3& maxBound, int i)
+{
+    for(int k = 0; k < 3; k++){
+        Min[k] = minBound.elements[k];
+        Max[k] = maxBound.elements[k];
+        centroid[k] = (Min[k] + Max[k]) * 0.5f;
+    }
+    index = i;
+}
+
+BVH::BVH(int leafSize)
+{
+    maxLeaf = leafSize;
+
+    //split into parallel tasks until every hardware thread has a subtree
+    int threads = max((int)std::thread::hardware_concurrency(), 1);
+    parallelDepth = 1;
+    while((1 << parallelDepth) < threads)
+        parallelDepth++;
+}
+
+void BVH::createTree(vector<BVHPrimitive>& primitives)
+{
+    vector<BVHNode> buildNodes;
+    vector<int> buildIndices;
+
+    if(primitives.size() > 0){
+        buildNodes.reserve(primitives.size() * 2);
+        buildIndices.reserve(primitives.size());
+        buildNode(primitives, 0, primitives.size(), 1, buildNodes, buildIndices);
+    }
+
+    //copy the finished tree into its compact aligned form
+    nodes.assign(buildNodes);
+    indices.assign(buildIndices);
+}
+
+int BVH::buildNode(vector<BVHPrimitive>& primitives, int start, int end, int depth, vector<BVHNode>& outNodes, vector<int>& outIndices)
+{
+    int index = outNodes.size();
+    outNodes.push_back(BVHNode());
+
+    //bounds of the primitives and of their centroids
+    float Min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float Max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    float cMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float cMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for(int i = start; i < end; i++){
+        growBounds(Min, Max, primitives[i].Min, primitives[i].Max);
+        growBounds(cMin, cMax, primitives[i].centroid, primitives[i].centroid);
+    }
+
+    for(int k = 0; k < 3; k++){
+        outNodes[index].Min[k] = Min[k];
+        outNodes[index].Max[k] = Max[k];
+    }
+
+    int count = end - start;
+
+    //only split while the traversal stack can hold the tree, expanding
+    //a node leaves one pending sibling per level above it plus both
+    //children, so the deepest leaves sit one level above maxStack
+    bool split = false;
+    int axis, bin;
+    if(count > 1 && depth < maxStack - 1){
+        float cost;
+        if(findSplit(primitives, start, end, surfaceArea(Min, Max), cMin, cMax, axis, bin, cost))
+            split = cost < (float)count || count > maxLeaf;
+    }
+
+    if(!split){
+        outNodes[index].offset = outIndices.size();
+        outNodes[index].count = count;
+        for(int i = start; i < end; i++)
+            outIndices.push_back(primitives[i].index);
+        return index;
+    }
+
+    int mid = partition(primitives, start, end, axis, cMin[axis], cMax[axis], bin);
+    if(mid == start || mid == end)
+        mid = (start + end) / 2;
+
+    int right;
+    if(count >= parallelThreshold && depth <= parallelDepth){
+        //the halves touch disjoint primitive ranges, so the right
+        //subtree can be built on its own thread and spliced in after
+        vector<BVHNode> rightNodes;
+        vector<int> rightIndices;
+        std::thread worker(&BVH::buildNode, this, std::ref(primitives), mid, end, depth + 1,
+                           std::ref(rightNodes), std::ref(rightIndices));
+        buildNode(primitives, start, mid, depth + 1, outNodes, outIndices);
+        worker.join();
+        right = appendTree(outNodes, outIndices, rightNodes, rightIndices);
+    }
+    else{
+        buildNode(primitives, start, mid, depth + 1, outNodes, outIndices);
+        right = buildNode(primitives, mid, end, depth + 1, outNodes, outIndices);
+    }
+
+    outNodes[index].offset = right;
+    outNodes[index].count = 0;
+    return index;
+}
+
+//appends a separately built subtree and returns the index of its root
+int BVH::appendTree(vector<BVHNode>& outNodes, vector<int>& outIndices, vector<BVHNode>& subNodes, vector<int>& subIndices)
+{
+    int nodeBase = outNodes.size();
+    int indexBase = outIndices.size();
+
+    for(int i = 0; i < subNodes.size(); i++){
+        BVHNode n = subNodes[i];
+        if(n.count > 0)
+            n.offset += indexBase;
+        else
+            n.offset += nodeBase;
+        outNodes.push_back(n);
+    }
+    outIndices.insert(outIndices.end(), subIndices.begin(), subIndices.end());
+
+    return nodeBase;
+}
+
+//finds the cheapest binned SAH split of the primitive range
+bool BVH::findSplit(vector<BVHPrimitive>& primitives, int start, int end, float nodeArea, float* cMin, float* cMax, int& bestAxis, int& bestBin, float& bestCost)
+{
+    bestCost = FLT_MAX;
+    bestAxis = -1;
+
+    for(int axis = 0; axis < 3; axis++){
+        if(cMax[axis] - cMin[axis] <= 0.0f)
+            continue;
+
+        Bin bins[numBins];
+        for(int i = 0; i < numBins; i++){
+            bins[i].count = 0;
+            for(int k = 0; k < 3; k++){
+                bins[i].Min[k] = FLT_MAX;
+                bins[i].Max[k] = -FLT_MAX;
+            }
+        }
+
+        for(int i = start; i < end; i++){
+            int b = binIndex(primitives[i], axis, cMin[axis], cMax[axis]);
+            bins[b].count++;
+            growBounds(bins[b].Min, bins[b].Max, primitives[i].Min, primitives[i].Max);
+        }
+
+        //sweep from the right to get the area and count of every right side
+        float rightArea[numBins];
+        int rightCount[numBins];
+        float Min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+        float Max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        int num = 0;
+        for(int i = numBins - 1; i > 0; i--){
+            growBounds(Min, Max, bins[i].Min, bins[i].Max);
+            num += bins[i].count;
+            rightArea[i] = surfaceArea(Min, Max);
+            rightCount[i] = num;
+        }
+
+        //sweep from the left and evaluate every split plane
+        for(int k = 0; k < 3; k++){
+            Min[k] = FLT_MAX;
+            Max[k] = -FLT_MAX;
+        }
+        num = 0;
+        for(int i = 0; i < numBins - 1; i++){
+            growBounds(Min, Max, bins[i].Min, bins[i].Max);
+            num += bins[i].count;
+            if(num == 0 || rightCount[i + 1] == 0)
+                continue;
+
+            float cost = 1.0f + (surfaceArea(Min, Max) * num + rightArea[i + 1] * rightCount[i + 1]) / nodeArea;
+            if(cost < bestCost){
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = i;
+            }
+        }
+    }
+
+    return bestAxis != -1;
+}
+
+//moves every primitive in a bin at or below the split bin to the front
+int BVH::partition(vector<BVHPrimitive>& primitives, int start, int end, int axis, float cMin, float cMax, int bin)
+{
+    int mid = start;
+    for(int i = start; i < end; i++){
+        if(binIndex(primitives[i], axis, cMin, cMax) <= bin){
+            std::swap(primitives[i], primitives[mid]);
+            mid++;
+        }
+    }
+    return mid;
+}
+
+int BVH::binIndex(BVHPrimitive& primitive, int axis, float cMin, float cMax)
+{
+    int b = (int)(numBins * (primitive.centroid[axis] - cMin) / (cMax - cMin));
+    if(b >= numBins)
+        b = numBins - 1;
+    if(b < 0)
+        b = 0;
+    return b;
+}
+
+void BVH::growBounds(float* Min, float* Max, const float* newMin, const float* newMax)
+{
+    for(int k = 0; k < 3; k++){
+        Min[k] = min(Min[k], newMin[k]);
+        Max[k] = max(Max[k], newMax[k]);
+    }
+}
+
+float BVH::surfaceArea(const float* Min, const float* Max)
+{
+    float dx = Max[0] - Min[0];
+    float dy = Max[1] - Min[1];
+    float dz = Max[2] - Min[2];
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+//slab test of the ray against a node, tNear is the entry distance
+bool BVH::intersectNode(int node, Vector3& origin, Vector3& invDir, float maxT, float& tNear)
+{
+    BVHNode& n = nodes[node];
+
+    float tMin = 0.0f;
+    float tMax = maxT;
+    for(int k = 0; k < 3; k++){
+        float t1 = (n.Min[k] - origin.elements[k]) * invDir.elements[k];
+        float t2 = (n.Max[k] - origin.elements[k]) * invDir.elements[k];
+        if(t1 > t2){
+            float tmp = t1;
+            t1 = t2;
+            t2 = tmp;
+        }
+        if(t1 > tMin)
+            tMin = t1;
+        if(t2 < tMax)
+            tMax = t2;
+        if(tMin > tMax)
+            return false;
+    }
+
+    tNear = tMin;
+    return true;
+}
+
+BVHNode* BVH::getNodes(void)
+{
+    return nodes.ptr();
+}
+
+int* BVH::getIndices(void)
+{
+    return indices.ptr();
+}
+
+int BVH::getNodeCount(void)
+{
+    return nodes.size();
+}
+
+int BVH::getIndexCount(void)
+{
+    return indices.size();
+}
+
+size_t BVH::getMemoryUsage(void)
+{
+    return nodes.getMemoryUsage() + indices.getMemoryUsage();
+}
+
+void BVH::getBounds(Vector3& minBound, Vector3& maxBound)
+{
+    if(nodes.size() == 0)
+        return;
+    minBound = Vector3(nodes[0].Min[0], nodes[0].Min[1], nodes[0].Min[2]);
+    maxBound = Vector3(nodes[0].Max[0], nodes[0].Max[1], nodes[0].Max[2]);
+}
@@ -0,0 +1,81 @@
+#ifndef BVH_H_INCLUDED
+#define BVH_H_INCLUDED
+
+#include <vector>
+#include "vector.h"
+#include "ray.h"
+#include "aligned.h"
+
+using namespace std;
+
+//a node of the flattened tree, the left child of an
+//interior node always directly follows its parent,
+//two nodes fit in a cache line
+struct BVHNode
+{
+    float Min[3];
+    int offset;     //first primitive for leaves, right child for interior nodes
+    float Max[3];
+    int count;      //number of primitives, 0 for interior nodes
+};
+
+//the bounds of a single primitive handed to the builder
+struct BVHPrimitive
+{
+    float Min[3];
+    float Max[3];
+    float centroid[3];
+    int index;
+
+    BVHPrimitive(Vector3&, Vector3&, int);
+};
+
+class BVH
+{
+    public:
+
+        BVH(int);
+
+        void createTree(vector<BVHPrimitive>&);
+
+        bool intersectNode(int, Vector3&, Vector3&, float, float&);
+
+        BVHNode* getNodes(void);
+        int* getIndices(void);
+        int getNodeCount(void);
+        int getIndexCount(void);
+        size_t getMemoryUsage(void);
+
+        void getBounds(Vector3&, Vector3&);
+
+        static const int maxStack = 64;
+
+    private:
+
+        struct Bin
+        {
+            float Min[3];
+            float Max[3];
+            int count;
+        };
+
+        int buildNode(vector<BVHPrimitive>&, int, int, int, vector<BVHNode>&, vector<int>&);
+        int appendTree(vector<BVHNode>&, vector<int>&, vector<BVHNode>&, vector<int>&);
+        bool findSplit(vector<BVHPrimitive>&, int, int, float, float*, float*, int&, int&, float&);
+        int partition(vector<BVHPrimitive>&, int, int, int, float, float, int);
+        int binIndex(BVHPrimitive&, int, float, float);
+
+        void growBounds(float*, float*, const float*, const float*);
+        float surfaceArea(const float*, const float*);
+
+        AlignedArray<BVHNode> nodes;
+        AlignedArray<int> indices;
+
+        int maxLeaf;
+        int parallelDepth;
+
+        static const int numBins = 16;
+        static const int parallelThreshold = 4096;
+};
+
+#endif // BVH_H_INCLUDED
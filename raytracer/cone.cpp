@@ -8,7 +8,7 @@ Cone::Cone(Vector3 newBase, float newHeight, float newRad)
     height = newHeight;
 }
 
-bool Cone::Intersection(Ray& ray, Hitpoint& h)
+bool Cone::Intersection(Ray& ray, Hitpoint& h, float tMin, float tMax)
 {
     Vector3 o = ray.origin;
     Vector3 d = ray.dir;
@@ -38,6 +38,10 @@ bool Cone::Intersection(Ray& ray, Hitpoint& h)
         maxT = t1;
     }
 
+    //the base only moves the entry further along the ray
+    if(minT >= tMax)
+        return false;
+
     h.f1 = (float)SIDE;
 
     if(d.y <= 0.0f){
@@ -68,6 +72,9 @@ bool Cone::Intersection(Ray& ray, Hitpoint& h)
             return false;
     }
 
+    if(minT <= tMin || minT >= tMax)
+        return false;
+
     h.t = minT;
     return true;
 }
@@ -82,6 +89,13 @@ Vector3 Cone::getNormal(Ray& ray)
         return Vector3(0, -1, 0);
 }
 
+bool Cone::getBounds(Vector3& minBound, Vector3& maxBound)
+{
+    minBound = Vector3(base.x - radius, base.y, base.z - radius);
+    maxBound = Vector3(base.x + radius, base.y + height, base.z + radius);
+    return true;
+}
+
 void Cone::getUV(Vector3& point, Ray& ray, float& u, float& v)
 {
     if((Sides)ray.cacheFloat1 == SIDE){
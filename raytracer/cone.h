@@ -14,8 +14,9 @@ class Cone : public Shape
 
     private:
 
-        bool Intersection(Ray&, Hitpoint&);
+        bool Intersection(Ray&, Hitpoint&, float, float);
         Vector3 getNormal(Ray&);
+        bool getBounds(Vector3&, Vector3&);
 
         enum Sides {SIDE, BOTTOM};
 
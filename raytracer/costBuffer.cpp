@@ -0,0 +1,87 @@
+#include "costBuffer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+CostBuffer::CostBuffer(int w, int h, Mode m)
+{
+    width = w;
+    height = h;
+    mode = m;
+    costs.resize(w * h, 0.0f);
+}
+
+//threads only ever add to the pixels of their own tiles
+void CostBuffer::add(int x, int y, int w, int h, float cost)
+{
+    float share = cost / (w * h);
+    for(int i = 0; i < h; i++){
+        for(int j = 0; j < w; j++)
+            costs[(y + i) * width + x + j] += share;
+    }
+}
+
+CostBuffer::Mode CostBuffer::getMode(void)
+{
+    return mode;
+}
+
+int CostBuffer::getWidth(void)
+{
+    return width;
+}
+
+int CostBuffer::getHeight(void)
+{
+    return height;
+}
+
+float CostBuffer::getCost(int x, int y)
+{
+    return costs[y * width + x];
+}
+
+//colors every pixel relative to the 99th percentile cost,
+//so a few outliers do not leave the rest of the map black
+void CostBuffer::writeHeatmap(Image* image)
+{
+    vector<float> sorted(costs);
+    int index = min((int)(sorted.size() * 0.99f), (int)sorted.size() - 1);
+    nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    float scale = sorted[index] > 0.0f ? 1.0f / sorted[index] : 0.0f;
+
+    for(int y = 0; y < height; y++){
+        for(int x = 0; x < width; x++){
+            Vector3 color = falseColor(costs[y * width + x] * scale);
+            image->setPixel(x, y, color);
+        }
+    }
+}
+
+//black, blue, red, yellow to white as the cost rises
+Vector3 CostBuffer::falseColor(float value)
+{
+    static const Vector3 ramp[5] = {Vector3(0, 0, 0), Vector3(0.1f, 0.1f, 0.8f), Vector3(0.9f, 0.1f, 0.2f),
+                                    Vector3(1, 0.9f, 0.1f), Vector3(1, 1, 1)};
+
+    value = max(0.0f, min(value, 1.0f)) * 4.0f;
+    int i = min((int)value, 3);
+    float f = value - i;
+    return ramp[i] * (1.0f - f) + ramp[i + 1] * f;
+}
+
+//the costs as a grayscale Portable Float Map, rows run bottom to
+//top and the negative scale marks the floats as little endian
+bool CostBuffer::writeRaw(std::string fileName)
+{
+    FILE* file = fopen(fileName.c_str(), "wb");
+    if(file == NULL)
+        return false;
+
+    fprintf(file, "Pf\n%d %d\n-1.0\n", width, height);
+    bool written = true;
+    for(int y = height - 1; y >= 0; y--)
+        written = written && fwrite(&costs[y * width], sizeof(float), width, file) == width;
+    fclose(file);
+    return written;
+}
@@ -0,0 +1,42 @@
+#ifndef COSTBUFFER_H_INCLUDED
+#define COSTBUFFER_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+#include "image.h"
+
+//render cost of every pixel, the manager measures each traced tile
+//and spreads its cost evenly over the tile's pixels, so the map is
+//exact per pixel with a packet size of one
+class CostBuffer
+{
+    public:
+
+        //seconds spent or rays cast, rays are only counted with RAY_STATS
+        enum Mode {TIME, RAYS};
+
+        CostBuffer(int, int, Mode);
+
+        void add(int, int, int, int, float);
+
+        Mode getMode(void);
+        int getWidth(void);
+        int getHeight(void);
+        float getCost(int, int);
+
+        void writeHeatmap(Image*);
+        bool writeRaw(std::string);
+
+    private:
+
+        Vector3 falseColor(float);
+
+        int width;
+        int height;
+        Mode mode;
+
+        std::vector<float> costs;
+};
+
+#endif // COSTBUFFER_H_INCLUDED
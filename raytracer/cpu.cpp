@@ -0,0 +1,49 @@
+#include "cpu.h"
+
+CPU::Level CPU::getLevel(void)
+{
+    static Level level = detect();
+    return level;
+}
+
+//number of triangles tested at once by the mesh kernels
+int CPU::getWidth(void)
+{
+    switch(getLevel())
+    {
+        case AVX2:
+            return 8;
+        case SSE:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+std::string CPU::getName(void)
+{
+    switch(getLevel())
+    {
+        case AVX2:
+            return "AVX2";
+        case SSE:
+            return "SSE";
+        default:
+            return "scalar";
+    }
+}
+
+CPU::Level CPU::detect(void)
+{
+#ifdef CPU_AVX2
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return AVX2;
+#endif
+
+#ifdef CPU_SSE
+    return SSE;
+#else
+    return SCALAR;
+#endif
+}
@@ -0,0 +1,35 @@
+#ifndef CPU_H_INCLUDED
+#define CPU_H_INCLUDED
+
+#include <string>
+
+//SSE2 is part of every x86-64 target, AVX2 kernels are compiled with a
+//function target attribute and only called when the CPU reports support
+#if defined(__SSE2__) || defined(_M_X64)
+    #define CPU_SSE
+#endif
+
+#if defined(CPU_SSE) && defined(__GNUC__)
+    #define CPU_AVX2
+    #define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+//vector instruction set picked for the intersection kernels at runtime
+class CPU
+{
+    public:
+
+        enum Level {SCALAR, SSE, AVX2};
+
+        static Level getLevel(void);
+        static int getWidth(void);
+        static std::string getName(void);
+
+    private:
+
+        CPU(void){}
+
+        static Level detect(void);
+};
+
+#endif // CPU_H_INCLUDED
@@ -8,7 +8,7 @@ Cylinder::Cylinder(Vector3 newBase, float newHeight, float newRadius)
     radius = newRadius;
 }
 
-bool Cylinder::Intersection(Ray& ray, Hitpoint& h)
+bool Cylinder::Intersection(Ray& ray, Hitpoint& h, float tMin, float tMax)
 {
     Vector3 o = ray.origin;
     Vector3 d = ray.dir;
@@ -36,6 +36,10 @@ bool Cylinder::Intersection(Ray& ray, Hitpoint& h)
         maxT = c1;
     }
 
+    //the caps only move the entry further along the ray
+    if(minT >= tMax)
+        return false;
+
     h.f1 = (float)SIDE;
 
     float minY, maxY;
@@ -72,6 +76,9 @@ bool Cylinder::Intersection(Ray& ray, Hitpoint& h)
             return false;
     }
 
+    if(minT <= tMin || minT >= tMax)
+        return false;
+
     h.t = minT;
     return true;
 }
@@ -97,6 +104,13 @@ Vector3 Cylinder::getNormal(Ray& ray)
     return result;
 }
 
+bool Cylinder::getBounds(Vector3& minBound, Vector3& maxBound)
+{
+    minBound = Vector3(base.x - radius, base.y, base.z - radius);
+    maxBound = Vector3(base.x + radius, base.y + height, base.z + radius);
+    return true;
+}
+
 void Cylinder::getUV(Vector3& point, Ray& ray, float& u, float& v)
 {
     if((PART_ID)ray.cacheFloat1 == SIDE){
@@ -16,8 +16,9 @@ class Cylinder : public Shape
 
     private:
 
-        bool Intersection(Ray&, Hitpoint&);
+        bool Intersection(Ray&, Hitpoint&, float, float);
         Vector3 getNormal(Ray&);
+        bool getBounds(Vector3&, Vector3&);
 
         enum PART_ID {SIDE, TOP, BOTTOM};
 
@@ -1,5 +1,6 @@
 #include "hemisphere.h"
 #include "ray.h"
+#include "random.h"
 
 Hemisphere::Hemisphere(Vector3& normal, float maxAngle)
 {
@@ -28,8 +29,9 @@ Hemisphere::Hemisphere(Vector3& normal, float maxAngle)
 
 Vector3 Hemisphere::sample(void)
 {
-    float u = (float)(rand() % 1025) / 1024.0f;
-    float v = (float)(rand() % 1025) / 1024.0f;
+    Random& random = Random::local();
+    float u = random.nextFloat();
+    float v = random.nextFloat();
     Vector3 direction(0, 0, 0);
     computeDirection(u, v, direction);
     return direction;
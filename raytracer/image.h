@@ -9,6 +9,8 @@ class Image
 {
     public:
 
+        virtual ~Image(){}
+
         virtual void setPixel(int, int, Vector3&) =0;
         virtual Vector3 getPixel(int, int) =0;
         virtual uint8_t* getPtr(void) = 0;
@@ -1,5 +1,6 @@
 #include "light.h"
 #include "raytracer.h"
+#include "random.h"
 
 Light::Light(Raytracer* r, Vector3 p, Vector3 c, Vector3 f, float i)
 {
@@ -36,26 +37,58 @@ float Light::getAttenuation(float dist)
     return 1.0f / poly;
 }
 
+//the lights shade first and only trace shadow rays when what the light
+//adds to the point is above the scene's threshold
+bool Light::worthTracing(Vector3& contribution)
+{
+    float strength = max(max(contribution.x, contribution.y), contribution.z);
+    return strength > raytracer->getShadowThreshold();
+}
+
+//below the threshold the light is treated as blocked
+float Light::visibility(Vector3& contribution, Ray& shadow, float range)
+{
+    if(!worthTracing(contribution))
+        return 0.0f;
+    return raytracer->computeShadowFactor(shadow, range);
+}
+
+//bounds of a light at the position that shines in every direction
+LightBounds Light::pointBounds(void)
+{
+    LightBounds bounds;
+    bounds.minBound = position;
+    bounds.maxBound = position;
+    bounds.axis = Vector3(0, 0, 1);
+    bounds.thetaNormal = 3.1415926f;
+    bounds.thetaEmit = 3.1415926f / 2.0f;
+    bounds.power = intensity * max(max(lightColor.x, lightColor.y), lightColor.z);
+    bounds.falloff = falloff;
+    return bounds;
+}
+
 PointLight::PointLight(Raytracer* r, Vector3 p, Vector3 c, Vector3 f, float i)
  : Light(r, p, c, f, i) {}
 
 Vector3 PointLight::illuminate(Ray& ray, Vector3& n, Vector3& diffuse)
 {
     Ray shadow(ray.point, position - ray.point);
-    float factor = raytracer->computeShadowFactor(shadow, 1.0f);
-    if(factor > 0.0f){
-        Vector3 l = shadow.dir;
-        float atten = getAttenuation(l.getLength());
-        l.normalize();
-
-        Vector3 color = factor * atten * intensity * raytracer->calculateShading(ray, n, l, diffuse);
-        color.x *= lightColor.x;
-        color.y *= lightColor.y;
-        color.z *= lightColor.z;
-        return color;
-    }
+    Vector3 l = shadow.dir;
+    float atten = getAttenuation(l.getLength());
+    l.normalize();
+
+    Vector3 color = atten * intensity * raytracer->calculateShading(ray, n, l, diffuse);
+    color.x *= lightColor.x;
+    color.y *= lightColor.y;
+    color.z *= lightColor.z;
 
-    return Vector3(0, 0, 0);
+    return color * visibility(color, shadow, 1.0f);
+}
+
+bool PointLight::computeBounds(LightBounds& bounds)
+{
+    bounds = pointBounds();
+    return true;
 }
 
 void PointLight::emitPhotons(PhotonMap& photonMap, int num, int maxBounces)
@@ -65,7 +98,7 @@ void PointLight::emitPhotons(PhotonMap& photonMap, int num, int maxBounces)
     while(emitted < num){
         Vector3 dir;
         for(int i = 0; i < 3; i++)
-            dir.elements[i] = (float)((rand() % 1001) - 500) / 500.0f;
+            dir.elements[i] = 2.0f * Random::local().nextFloat() - 1.0f;
         if(dir.getLength() <= 1.0f){
             dir.normalize();
             Vector3 power = intensity * lightColor * (1.0f / (float)num);
@@ -81,20 +114,41 @@ DirectionalLight::DirectionalLight(Raytracer* r, Vector3 d, Vector3 c, float i)
 {
     direction = -d;
     direction.normalize();
+    shadowMap = NULL;
+}
+
+DirectionalLight::~DirectionalLight()
+{
+    delete shadowMap;
 }
 
 Vector3 DirectionalLight::illuminate(Ray& ray, Vector3& n, Vector3& diffuse)
 {
     Ray shadow(ray.point, direction);
-    float factor = raytracer->computeShadowFactor(shadow, FLT_MAX);
-    if(factor > 0.0f){
-        Vector3 color = factor * intensity * raytracer->calculateShading(ray, n, direction, diffuse);
-        color.x *= lightColor.x;
-        color.y *= lightColor.y;
-        color.z *= lightColor.z;
-        return color;
+    Vector3 color = intensity * raytracer->calculateShading(ray, n, direction, diffuse);
+    color.x *= lightColor.x;
+    color.y *= lightColor.y;
+    color.z *= lightColor.z;
+
+    //the shadow map only covers the bounded objects, points outside
+    //of it still trace their shadow ray
+    if(shadowMap != NULL){
+        float factor = shadowMap->lookup(ray.point);
+        if(factor >= 0.0f)
+            return color * factor;
     }
-    return Vector3(0, 0, 0);
+
+    return color * visibility(color, shadow, FLT_MAX);
+}
+
+//looks at the scene bounds from the light, replaces the shadow rays of
+//draft renders with lookups
+bool DirectionalLight::createShadowMap(int size, Vector3& minBound, Vector3& maxBound)
+{
+    delete shadowMap;
+    shadowMap = new ShadowMap(size);
+    shadowMap->createMap(raytracer, direction, minBound, maxBound);
+    return true;
 }
 
 Spotlight::Spotlight(Raytracer* r, Vector3 p, Vector3 l, Vector3 c, Vector3 f, float i, float in, float out)
@@ -110,32 +164,39 @@ Spotlight::Spotlight(Raytracer* r, Vector3 p, Vector3 l, Vector3 c, Vector3 f, f
 Vector3 Spotlight::illuminate(Ray& ray, Vector3& n, Vector3& diffuse)
 {
     Ray shadow(ray.point, position - ray.point);
-    float factor = raytracer->computeShadowFactor(shadow, 1.0f);
-    if(factor > 0.0f){
-        Vector3 l = shadow.dir;
-        float atten = getAttenuation(l.getLength());
-        l.normalize();
-
-        float newIntensity;
-        float diff = Vector3::DotProduct(lookat, l);
-
-        if(diff >= inner)
-            newIntensity = intensity;
-        else if(diff > outer){
-            float val = (1 - ((diff - inner) / (outer - inner)));
-            newIntensity = intensity * val * val * (3.0f - 2.0f * val);
-        }
-        else
-            return Vector3(0, 0, 0);
-
-        Vector3 color = factor * atten * newIntensity * raytracer->calculateShading(ray, n, l, diffuse);
-        color.x *= lightColor.x;
-        color.y *= lightColor.y;
-        color.z *= lightColor.z;
-        return color;
+    Vector3 l = shadow.dir;
+    float atten = getAttenuation(l.getLength());
+    l.normalize();
+
+    //points outside the cone get nothing, whatever is in the way
+    float newIntensity;
+    float diff = Vector3::DotProduct(lookat, l);
+
+    if(diff >= inner)
+        newIntensity = intensity;
+    else if(diff > outer){
+        float val = (1 - ((diff - inner) / (outer - inner)));
+        newIntensity = intensity * val * val * (3.0f - 2.0f * val);
     }
+    else
+        return Vector3(0, 0, 0);
+
+    Vector3 color = atten * newIntensity * raytracer->calculateShading(ray, n, l, diffuse);
+    color.x *= lightColor.x;
+    color.y *= lightColor.y;
+    color.z *= lightColor.z;
 
-    return Vector3(0, 0, 0);
+    return color * visibility(color, shadow, 1.0f);
+}
+
+//the spotlight shines away from its lookat vector up to the outer angle
+bool Spotlight::computeBounds(LightBounds& bounds)
+{
+    bounds = pointBounds();
+    bounds.axis = -lookat;
+    bounds.thetaNormal = 0.0f;
+    bounds.thetaEmit = acosf(max(-1.0f, min(outer, 1.0f)));
+    return true;
 }
 
 AreaLight::AreaLight(Raytracer* ray, Vector3 p, Vector3 r, Vector3 u, Vector3 c, Vector3 f, float i, float sx, float sy)
@@ -145,6 +206,7 @@ AreaLight::AreaLight(Raytracer* ray, Vector3 p, Vector3 r, Vector3 u, Vector3 c,
     up = u;
     samplesx = sx;
     samplesy = sy;
+    surface = NULL;
 }
 
 Vector3 AreaLight::illuminate(Ray& ray, Vector3& n, Vector3& diffuse)
@@ -211,37 +273,156 @@ Vector3 AreaLight::illuminate(Ray& ray, Vector3& n, Vector3& diffuse)
     if(Vector3::DotProduct(lightDir, pointDir) < 0)
         return Vector3(0, 0, 0);
 
-    Vector3 totalColor(0, 0, 0);
-    float currentX = 0.0f;
-    float currentY = 0.0f;
-    float xStep = 1.0f / (float)samplesx;
-    float yStep = 1.0f / (float)samplesy;
+    Random& random = Random::local();
+    bool adaptive = raytracer->getAdaptiveShadows();
 
+    //shade every stratum first, the threshold applies to what the
+    //whole light adds to the point and not to a single sample
+    int count = (int)samplesx * (int)samplesy;
+    static thread_local vector<Vector3> colors;
+    static thread_local vector<Vector3> targets;
+    colors.resize(count);
+    targets.resize(count);
+
+    Vector3 unshadowed(0, 0, 0);
     for(int i = 0; i < samplesy; i++){
-        currentX = 0.0f;
         for(int j = 0; j < samplesx; j++){
-            float xRand = (rand() % 1025) / 1024.0f;
-            float yRand = (rand() % 1025) / 1024.0f;
-            Vector3 p = position + ((currentX + xRand * xStep) * right) + ((currentY + yRand * yStep) * up);
-            Ray shadow(ray.point, p - ray.point);
-            float factor = raytracer->computeShadowFactor(shadow, 1.0f);
-            if(factor > 0.0f){
-                Vector3 l = shadow.dir;
-                float atten = getAttenuation(l.getLength());
-                l.normalize();
+            int k = i * (int)samplesx + j;
+            colors[k] = sampleStratum(ray, n, diffuse, j, i, random, targets[k]);
+            unshadowed += colors[k];
+        }
+    }
+    float share = 1.0f / (float)count;
+    unshadowed = unshadowed * share;
+    if(!worthTracing(unshadowed))
+        return Vector3(0, 0, 0);
 
-                Vector3 color = factor * atten * intensity * raytracer->calculateShading(ray, n, l, diffuse);
-                color.x *= lightColor.x;
-                color.y *= lightColor.y;
-                color.z *= lightColor.z;
-                totalColor += color;
+    Vector3 totalColor(0, 0, 0);
+
+    //the adaptive mode traces the probe strata first, when they all see
+    //the light the same way the point is taken to be fully lit or fully
+    //shadowed and the other strata reuse that instead of a shadow ray,
+    //probes facing away from the point trace nothing and don't count
+    float shared = -1.0f;
+    if(adaptive){
+        bool agree = true;
+        int traced = 0;
+        for(int i = 0; i < samplesy; i++){
+            for(int j = 0; j < samplesx; j++){
+                if(!isProbe(j, i))
+                    continue;
+                int k = i * (int)samplesx + j;
+                float factor = traceStratum(ray, colors[k], targets[k]);
+                if(factor < 0.0f)
+                    continue;
+                totalColor += colors[k] * factor;
+                if(traced++ == 0)
+                    shared = factor;
+                else if(factor != shared)
+                    agree = false;
             }
-            currentX += xStep;
         }
-        currentY += yStep;
+        if(!agree || traced < 2)
+            shared = -1.0f;
     }
 
-    return totalColor * (1.0f / (float)(samplesx * samplesy));
+    for(int i = 0; i < samplesy; i++){
+        for(int j = 0; j < samplesx; j++){
+            if(adaptive && isProbe(j, i))
+                continue;
+            int k = i * (int)samplesx + j;
+            float factor = shared >= 0.0f ? shared : traceStratum(ray, colors[k], targets[k]);
+            if(factor > 0.0f)
+                totalColor += colors[k] * factor;
+        }
+    }
+
+    return totalColor * share;
+}
+
+//shades a jittered point in stratum x, y of the light without its
+//shadow, target is the point on the light
+Vector3 AreaLight::sampleStratum(Ray& ray, Vector3& n, Vector3& diffuse, int x, int y, Random& random, Vector3& target)
+{
+    float xStep = 1.0f / (float)samplesx;
+    float yStep = 1.0f / (float)samplesy;
+    float xRand = random.nextFloat();
+    float yRand = random.nextFloat();
+    target = position + ((x * xStep + xRand * xStep) * right) + ((y * yStep + yRand * yStep) * up);
+    Vector3 l = target - ray.point;
+    float atten = getAttenuation(l.getLength());
+    l.normalize();
+
+    Vector3 color = atten * intensity * raytracer->calculateShading(ray, n, l, diffuse);
+    color.x *= lightColor.x;
+    color.y *= lightColor.y;
+    color.z *= lightColor.z;
+    return color;
+}
+
+//visibility of the target, a stratum that adds nothing needs no ray
+//and returns -1 as it says nothing about the shadow
+float AreaLight::traceStratum(Ray& ray, Vector3& color, Vector3& target)
+{
+    if(max(max(color.x, color.y), color.z) <= 0.0f)
+        return -1.0f;
+    Ray shadow(ray.point, target - ray.point);
+    return raytracer->computeShadowFactor(shadow, 1.0f);
+}
+
+//the corner strata and the one in the middle of the light
+bool AreaLight::isProbe(int x, int y)
+{
+    int lastX = (int)samplesx - 1;
+    int lastY = (int)samplesy - 1;
+    return ((x == 0 || x == lastX) && (y == 0 || y == lastY)) || (x == lastX / 2 && y == lastY / 2);
+}
+
+//the emissive plane that shows the light in the scene
+void AreaLight::setSurface(Shape* s)
+{
+    surface = s;
+}
+
+Shape* AreaLight::getSurface(void)
+{
+    return surface;
+}
+
+//a uniform point on the light seen from a point, pdf is per unit of
+//solid angle at the point so it compares with the pdf of a direction
+bool AreaLight::sampleSurface(Vector3& from, float u, float v, Vector3& point, float& pdf)
+{
+    point = position + u * right + v * up;
+    pdf = surfacePdf(from, point);
+    return pdf > 0.0f;
+}
+
+float AreaLight::surfacePdf(Vector3& from, Vector3& point)
+{
+    Vector3 normal = Vector3::CrossProduct(right, up);
+    float area = normal.getLength();
+    Vector3 d = point - from;
+    float dist = d.getSqrLength();
+    float cosine = fabs(Vector3::DotProduct(normal, d)) / (area * sqrtf(dist));
+    if(cosine <= 0.0f)
+        return 0.0f;
+    return dist / (cosine * area);
+}
+
+//the area light only lights the side its right and up vectors face
+bool AreaLight::computeBounds(LightBounds& bounds)
+{
+    bounds = pointBounds();
+    for(int k = 0; k < 3; k++){
+        float corners[4] = {0.0f, right.elements[k], up.elements[k], right.elements[k] + up.elements[k]};
+        bounds.minBound.elements[k] += *min_element(corners, corners + 4);
+        bounds.maxBound.elements[k] += *max_element(corners, corners + 4);
+    }
+    bounds.axis = Vector3::CrossProduct(right, up);
+    bounds.axis.normalize();
+    bounds.thetaNormal = 0.0f;
+    return true;
 }
 
 void AreaLight::emitPhotons(PhotonMap& photonMap, int num, int maxBounces)
@@ -256,8 +437,8 @@ void AreaLight::emitPhotons(PhotonMap& photonMap, int num, int maxBounces)
         Vector3 dir = hemi.sample();
         Vector3 power = intensity * lightColor * (1.0f / (float)num);
 
-        float uPos = (float)(rand() % 1001) / 1000.0f;
-        float vPos = (float)(rand() % 1001) / 1000.0f;
+        float uPos = Random::local().nextFloat();
+        float vPos = Random::local().nextFloat();
         Vector3 pos = position + uPos * right + vPos * up;
 
         Photon p(pos, dir, power);
@@ -4,8 +4,12 @@
 #include "vector.h"
 #include "photonMap.h"
 #include "photonTracer.h"
+#include "lightTree.h"
+#include "shadowMap.h"
 
 class Raytracer;
+class Random;
+class Shape;
 struct Ray;
 
 class Light
@@ -22,9 +26,22 @@ class Light
 
         virtual Vector3 illuminate(Ray&, Vector3&, Vector3&) =0;
         virtual void emitPhotons(PhotonMap&, int, int){};
+        virtual bool createShadowMap(int, Vector3&, Vector3&){return false;}
+
+        //lights with a visible surface, rays that hit it find the light too
+        virtual Shape* getSurface(void){return NULL;}
+        virtual bool sampleSurface(Vector3&, float, float, Vector3&, float&){return false;}
+        virtual float surfacePdf(Vector3&, Vector3&){return 0.0f;}
+
+        //lights without a position have no bounds and stay out of the light tree
+        virtual bool computeBounds(LightBounds&){return false;}
 
     protected:
 
+        bool worthTracing(Vector3&);
+        float visibility(Vector3&, Ray&, float);
+        LightBounds pointBounds(void);
+
         Vector3 position;
         Vector3 lightColor;
         Vector3 falloff;
@@ -40,6 +57,7 @@ class PointLight : public Light
         PointLight(Raytracer*, Vector3, Vector3, Vector3, float);
 
         Vector3 illuminate(Ray&, Vector3&, Vector3&);
+        bool computeBounds(LightBounds&);
 
         void emitPhotons(PhotonMap&, int, int);
 };
@@ -49,12 +67,15 @@ class DirectionalLight : public Light
     public:
 
         DirectionalLight(Raytracer*, Vector3, Vector3, float);
+        ~DirectionalLight();
 
         Vector3 illuminate(Ray&, Vector3&, Vector3&);
+        bool createShadowMap(int, Vector3&, Vector3&);
 
     private:
 
         Vector3 direction;
+        ShadowMap* shadowMap;
 };
 
 class Spotlight : public Light
@@ -64,6 +85,7 @@ class Spotlight : public Light
         Spotlight(Raytracer*, Vector3, Vector3, Vector3, Vector3, float, float, float);
 
         Vector3 illuminate(Ray&, Vector3&, Vector3&);
+        bool computeBounds(LightBounds&);
 
     private:
 
@@ -79,13 +101,24 @@ class AreaLight : public Light
         AreaLight(Raytracer*, Vector3, Vector3, Vector3, Vector3, Vector3, float, float, float);
 
         Vector3 illuminate(Ray&, Vector3&, Vector3&);
+        bool computeBounds(LightBounds&);
+
+        void setSurface(Shape*);
+        Shape* getSurface(void);
+        bool sampleSurface(Vector3&, float, float, Vector3&, float&);
+        float surfacePdf(Vector3&, Vector3&);
 
         void emitPhotons(PhotonMap&, int, int);
 
     private:
 
+        Vector3 sampleStratum(Ray&, Vector3&, Vector3&, int, int, Random&, Vector3&);
+        float traceStratum(Ray&, Vector3&, Vector3&);
+        bool isProbe(int, int);
+
         Vector3 right;
         Vector3 up;
+        Shape* surface;
 
         float samplesx;
         float samplesy;
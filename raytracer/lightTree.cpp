@@ -0,0 +1,186 @@
+#include "lightTree.h"
+#include "light.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+static const float PI = 3.1415926f;
+
+static float angleBetween(Vector3& a, Vector3& b)
+{
+    return acosf(max(-1.0f, min(Vector3::DotProduct(a, b), 1.0f)));
+}
+
+//grows the bounds to hold both groups, the axis cone is the smallest
+//cone around both cones, or the whole sphere when there is none
+void LightBounds::merge(const LightBounds& other)
+{
+    for(int k = 0; k < 3; k++){
+        minBound.elements[k] = min(minBound.elements[k], other.minBound.elements[k]);
+        maxBound.elements[k] = max(maxBound.elements[k], other.maxBound.elements[k]);
+        falloff.elements[k] = min(falloff.elements[k], other.falloff.elements[k]);
+    }
+    power += other.power;
+    thetaEmit = max(thetaEmit, other.thetaEmit);
+
+    Vector3 otherAxis = other.axis;
+    float thetaD = angleBetween(axis, otherAxis);
+    if(min(thetaD + other.thetaNormal, PI) <= thetaNormal)
+        return;
+    if(min(thetaD + thetaNormal, PI) <= other.thetaNormal){
+        axis = other.axis;
+        thetaNormal = other.thetaNormal;
+        return;
+    }
+
+    float theta = (thetaNormal + thetaD + other.thetaNormal) * 0.5f;
+    Vector3 rotation = Vector3::CrossProduct(axis, otherAxis);
+    if(theta >= PI || rotation.getSqrLength() == 0.0f){
+        thetaNormal = PI;
+        return;
+    }
+
+    //turn the axis towards the other one, they are perpendicular to the rotation
+    float angle = theta - thetaNormal;
+    rotation.normalize();
+    axis = axis * cosf(angle) + Vector3::CrossProduct(rotation, axis) * sinf(angle);
+    axis.normalize();
+    thetaNormal = theta;
+}
+
+//estimate of the light a point can receive from the group, zero only
+//when no light of the group can reach the point, the shading normal is
+//left out because the specular lobe also lights points behind it
+float LightBounds::importance(Vector3& point)
+{
+    Vector3 center = (minBound + maxBound) * 0.5f;
+    Vector3 dir = point - center;
+    float radius = (maxBound - minBound).getLength() * 0.5f;
+    float dist = dir.getLength();
+
+    //the smallest angle between the axis cone and the directions
+    //from the bounds to the point, inside the bounds anything goes
+    bool inside = true;
+    for(int k = 0; k < 3; k++)
+        inside = inside && point.elements[k] >= minBound.elements[k] && point.elements[k] <= maxBound.elements[k];
+    if(!inside && dist > radius && thetaNormal + thetaEmit < PI){
+        dir = dir * (1.0f / dist);
+        float thetaBounds = asinf(radius / dist);
+        float theta = max(0.0f, angleBetween(axis, dir) - thetaNormal - thetaBounds);
+        if(theta > thetaEmit)
+            return 0.0f;
+    }
+
+    dist = max(dist, radius);
+    float poly = falloff.x + falloff.y * dist + falloff.z * dist * dist;
+    return power / max(poly, 1e-6f);
+}
+
+LightTree::LightTree(void)
+{
+}
+
+void LightTree::createTree(vector<Light*>& newLights, vector<LightBounds>& bounds)
+{
+    lights = newLights;
+    nodes.clear();
+    if(lights.size() == 0)
+        return;
+
+    vector<int> order(lights.size());
+    for(int i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    nodes.reserve(lights.size() * 2);
+    buildNode(order, 0, order.size(), bounds);
+}
+
+//splits the lights in half along the widest axis of their centers
+int LightTree::buildNode(vector<int>& order, int start, int end, vector<LightBounds>& bounds)
+{
+    int index = nodes.size();
+    nodes.push_back(LightNode());
+
+    if(end - start == 1){
+        nodes[index].bounds = bounds[order[start]];
+        nodes[index].offset = order[start];
+        nodes[index].count = 1;
+        return index;
+    }
+
+    Vector3 cMin(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vector3 cMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(int i = start; i < end; i++){
+        Vector3 c = (bounds[order[i]].minBound + bounds[order[i]].maxBound) * 0.5f;
+        for(int k = 0; k < 3; k++){
+            cMin.elements[k] = min(cMin.elements[k], c.elements[k]);
+            cMax.elements[k] = max(cMax.elements[k], c.elements[k]);
+        }
+    }
+
+    int axis = 0;
+    Vector3 extent = cMax - cMin;
+    if(extent.y > extent.elements[axis])
+        axis = 1;
+    if(extent.z > extent.elements[axis])
+        axis = 2;
+
+    int mid = (start + end) / 2;
+    nth_element(order.begin() + start, order.begin() + mid, order.begin() + end,
+        [&](int a, int b){
+            return bounds[a].minBound.elements[axis] + bounds[a].maxBound.elements[axis] <
+                   bounds[b].minBound.elements[axis] + bounds[b].maxBound.elements[axis];
+        });
+
+    int left = buildNode(order, start, mid, bounds);
+    int right = buildNode(order, mid, end, bounds);
+
+    LightBounds merged = nodes[left].bounds;
+    merged.merge(nodes[right].bounds);
+    nodes[index].bounds = merged;
+    nodes[index].offset = right;
+    nodes[index].count = 0;
+    return index;
+}
+
+//picks a light for the point with the random number u, pdf is the chance
+//of that pick, returns NULL when no light of the tree reaches the point
+Light* LightTree::sample(Vector3& point, float u, float& pdf)
+{
+    pdf = 1.0f;
+    if(nodes.size() == 0 || nodes[0].bounds.importance(point) == 0.0f)
+        return NULL;
+
+    int index = 0;
+    while(nodes[index].count == 0){
+        float left = nodes[index + 1].bounds.importance(point);
+        float right = nodes[nodes[index].offset].bounds.importance(point);
+        if(left + right == 0.0f)
+            return NULL;
+
+        //reuse the random number for the next level
+        float chance = left / (left + right);
+        if(u < chance){
+            u = min(u / chance, 0.99999994f);
+            pdf *= chance;
+            index = index + 1;
+        }
+        else{
+            u = min((u - chance) / (1.0f - chance), 0.99999994f);
+            pdf *= 1.0f - chance;
+            index = nodes[index].offset;
+        }
+    }
+
+    return lights[nodes[index].offset];
+}
+
+int LightTree::getNodeCount(void)
+{
+    return nodes.size();
+}
+
+int LightTree::getLightCount(void)
+{
+    return lights.size();
+}
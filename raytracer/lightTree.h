@@ -0,0 +1,61 @@
+#ifndef LIGHTTREE_H_INCLUDED
+#define LIGHTTREE_H_INCLUDED
+
+#include <vector>
+#include "vector.h"
+
+using namespace std;
+
+class Light;
+
+//where a light or a group of lights sits and where it shines, the
+//emission axes lie within thetaNormal of axis and every light emits
+//up to thetaEmit past its own axis, angles are in radians
+struct LightBounds
+{
+    Vector3 minBound;
+    Vector3 maxBound;
+    Vector3 axis;
+    float thetaNormal;
+    float thetaEmit;
+    float power;
+    Vector3 falloff;    //smallest falloff terms of the group
+
+    void merge(const LightBounds&);
+    float importance(Vector3&);
+};
+
+//a node of the flattened tree, the left child of an
+//interior node always directly follows its parent
+struct LightNode
+{
+    LightBounds bounds;
+    int offset;     //light for leaves, right child for interior nodes
+    int count;      //1 for leaves, 0 for interior nodes
+};
+
+//binary tree over the lights with a position, a shading point picks
+//a light by walking down and choosing each child with a probability
+//proportional to how much light it can receive from it
+class LightTree
+{
+    public:
+
+        LightTree(void);
+
+        void createTree(vector<Light*>&, vector<LightBounds>&);
+
+        Light* sample(Vector3&, float, float&);
+
+        int getNodeCount(void);
+        int getLightCount(void);
+
+    private:
+
+        int buildNode(vector<int>&, int, int, vector<LightBounds>&);
+
+        vector<LightNode> nodes;
+        vector<Light*> lights;
+};
+
+#endif // LIGHTTREE_H_INCLUDED
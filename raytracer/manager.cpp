@@ -1,4 +1,7 @@
 #include "manager.h"
+#include "packet.h"
+#include "timer.h"
+#include "trace.h"
 
 Manager::Manager(int num, int blockSetup, Image* i, Raytracer* r)
 {
@@ -7,54 +10,104 @@ Manager::Manager(int num, int blockSetup, Image* i, Raytracer* r)
     img = i;
     raytracer = r;
     interruptFlag = false;
+    costs = NULL;
+    packetSize = raytracer->getPacketSize();
 
-    numBlocks = blockSetup * blockSetup;
-    currentBlock = 0;
-    blocks = new Block[numBlocks];
-    int x = 0;
-    int y = 0;
+    //the block grid is cut into small tiles made of whole packets
+    int tileSize = packetSize * 8;
+    vector<Block> initial;
     int xOffset = (int)((float)raytracer->getWidth() / (float)blockSetup);
     int yOffset = (int)((float)raytracer->getHeight() / (float)blockSetup);
-    int index = 0;
+    int y = 0;
     for(int i = 0; i < blockSetup; i++){
-        x = 0;
+        int x = 0;
+        int height = yOffset;
+        if(i == blockSetup - 1)
+            height = raytracer->getHeight() - y;
         for(int j = 0; j < blockSetup; j++){
-            blocks[index].width = xOffset;
-            blocks[index].height = yOffset;
-            blocks[index].initX = x;
-            blocks[index].initY = y;
-            if(i == blockSetup - 1)
-                blocks[index].height = raytracer->getHeight() - y;
+            int width = xOffset;
             if(j == blockSetup - 1)
-                blocks[index].width = raytracer->getWidth() - x;
-            index++;
+                width = raytracer->getWidth() - x;
+
+            for(int ty = 0; ty < height; ty += tileSize){
+                for(int tx = 0; tx < width; tx += tileSize){
+                    Block b;
+                    b.initX = x + tx;
+                    b.initY = y + ty;
+                    b.width = min(tileSize, width - tx);
+                    b.height = min(tileSize, height - ty);
+                    initial.push_back(b);
+                }
+            }
             x += xOffset;
         }
         y += yOffset;
     }
 
-    progress = new Progress(numThreads, blockSetup, blocks);
+    //a split always leaves at least one packet row behind,
+    //so there can not be more tiles than packets
+    int packetsX = (raytracer->getWidth() + packetSize - 1) / packetSize;
+    int packetsY = (raytracer->getHeight() + packetSize - 1) / packetSize;
+    int capacity = initial.size() + packetsX * packetsY;
+    tiles.resize(capacity);
+    tileCount = 0;
+    pending = 0;
+
+    //every thread starts on its own contiguous run of tiles
+    for(int t = 0; t < numThreads; t++)
+        queues.push_back(new TileQueue(capacity));
+    int numTiles = initial.size();
+    for(int t = 0; t < numThreads; t++){
+        int first = t * numTiles / numThreads;
+        int last = (t + 1) * numTiles / numThreads;
+        for(int k = last - 1; k >= first; k--){
+            Block& b = initial[k];
+            queues[t]->push(addTile(b.initX, b.initY, b.width, b.height));
+        }
+    }
+
+    for(int t = 0; t < numThreads; t++)
+        samplers.push_back(raytracer->createSampler());
+    threadStats.resize(numThreads);
+
+    progress = new Progress(raytracer->getWidth(), raytracer->getHeight());
 }
 
 Manager::~Manager(void)
 {
-    if(numThreads > 1){
-        for(int i = 0; i < numThreads; i++)
+    for(int i = 0; i < threads.size(); i++){
+        if(threads[i].joinable())
             threads[i].join();
     }
+
+    for(int i = 0; i < queues.size(); i++)
+        delete queues[i];
+    for(int i = 0; i < samplers.size(); i++)
+        delete samplers[i];
+    delete progress;
 }
 
 void Manager::Render(void)
 {
+    TraceScope scope("render", Log::intToString(numThreads) + " threads");
+
     if(numThreads == 1)
         basicRender();
     else{
         for(int i = 0; i < numThreads; i++)
             threads.push_back(thread(&Manager::threadedRender, this, i));
-        threadsActive = numThreads;
-        unique_lock<mutex> l(condMutex);
-        renderDone.wait(l);
+        for(int i = 0; i < numThreads; i++)
+            threads[i].join();
+        threads.clear();
     }
+
+    #ifdef RAY_STATS
+    stats.reset();
+    for(int i = 0; i < numThreads; i++)
+        stats.merge(threadStats[i]);
+    stats.report(raytracer->getWidth() * raytracer->getHeight());
+    stats.reportObjects(raytracer->getObjects(), reportedObjects);
+    #endif // RAY_STATS
 }
 
 void Manager::interrupt(void)
@@ -62,66 +115,197 @@ void Manager::interrupt(void)
     interruptFlag = true;
 }
 
+//walks the same tiles as the threaded path, the random
+//sequences are seeded per tile so the image is identical
 void Manager::basicRender(void)
 {
-    for(int i = 0; i < raytracer->getHeight(); i++){
-        for(int j = 0; j < raytracer->getWidth(); j++){
-            if(interruptFlag)
-                return;
-            Vector3 color = raytracer->tracePixel(j, i);
-            img->setPixel(j, i, color);
+    #ifdef RAY_STATS
+    RayStats::local().reset();
+    #endif // RAY_STATS
 
+    int tile;
+    while(!interruptFlag && queues[0]->pop(tile)){
+        traceBlock(tile, 0);
+        pending--;
+    }
+
+    #ifdef RAY_STATS
+    threadStats[0] = RayStats::local();
+    #endif // RAY_STATS
+}
+
+//traces a tile through the raytracer and copies it into the image
+void Manager::renderTile(int x, int y, int width, int height, int id)
+{
+    Vector3 colors[RayPacket::maxSize];
+    if(costs)
+        measureTile(x, y, width, height, colors, id);
+    else
+        raytracer->traceTile(x, y, width, height, colors, samplers[id]);
+
+    for(int i = 0; i < height; i++){
+        for(int j = 0; j < width; j++){
             #ifdef DEBUG
-            currentX++;
+            currentX = x + j;
+            currentY = y + i;
             #endif // DEBUG
+            img->setPixel(x + j, y + i, colors[i * width + j]);
         }
-        #ifdef DEBUG
-        currentX = 0;
-        currentY++;
-        #endif // DEBUG
-        progress->lineComplete();
     }
 }
 
+//traces a tile and adds its time or ray count to the cost buffer
+void Manager::measureTile(int x, int y, int width, int height, Vector3* colors, int id)
+{
+    #ifdef RAY_STATS
+    if(costs->getMode() == CostBuffer::RAYS){
+        long long before = RayStats::local().getRays();
+        raytracer->traceTile(x, y, width, height, colors, samplers[id]);
+        costs->add(x, y, width, height, RayStats::local().getRays() - before);
+        return;
+    }
+    #endif // RAY_STATS
+
+    Timer timer;
+    raytracer->traceTile(x, y, width, height, colors, samplers[id]);
+    costs->add(x, y, width, height, timer.elapsed());
+}
+
 void Manager::threadedRender(int id)
 {
-    Block* current = &blocks[0];
-    while(current){
-        int newBlock = nextBlock();
-        if(newBlock == -1){
-            current = NULL;
+    #ifdef RAY_STATS
+    RayStats::local().reset();
+    #endif // RAY_STATS
+
+    if(Trace::isEnabled())
+        Trace::setThreadName("render " + Log::intToString(id));
+
+    int tile;
+    while(!interruptFlag){
+        if(!nextTile(id, tile)){
+            //other threads may still split off work
+            if(pending == 0)
+                break;
+            this_thread::yield();
             continue;
         }
-        current = &blocks[newBlock];
-        for(int i = 0; i < current->height; i++){
-            for(int j = 0; j < current->width; j++){
-                if(interruptFlag)
-                    break;
-                Vector3 color = raytracer->tracePixel(current->initX + j, current->initY + i);
-                img->setPixel(current->initX + j, current->initY + i, color);
+
+        traceBlock(tile, id);
+        pending--;
+    }
+
+    //the thread's counters die with it
+    #ifdef RAY_STATS
+    threadStats[id] = RayStats::local();
+    #endif // RAY_STATS
+}
+
+//own tiles first, then steal from the other threads in turn
+bool Manager::nextTile(int id, int& tile)
+{
+    if(queues[id]->pop(tile))
+        return true;
+
+    for(int i = 1; i < numThreads; i++){
+        if(queues[(id + i) % numThreads]->steal(tile))
+            return true;
+    }
+    return false;
+}
+
+int Manager::addTile(int x, int y, int width, int height)
+{
+    int index = tileCount++;
+    if(index >= tiles.size())
+        return -1;
+
+    tiles[index].initX = x;
+    tiles[index].initY = y;
+    tiles[index].width = width;
+    tiles[index].height = height;
+    pending++;
+    return index;
+}
+
+//renders a tile as one event on the thread's timeline, split off
+//remainders show up as their own tiles when they are picked up
+void Manager::traceBlock(int index, int id)
+{
+    if(!Trace::isEnabled()){
+        renderBlock(index, id);
+        return;
+    }
+
+    Block b = tiles[index];
+    Trace::begin("tile", Log::intToString(b.initX) + "," + Log::intToString(b.initY) + " " +
+                 Log::intToString(b.width) + "x" + Log::intToString(b.height));
+    renderBlock(index, id);
+    Trace::end();
+}
+
+//renders a tile one row of packets at a time, when the cost of the rows
+//done so far predicts a long remainder, half of it is queued for stealing
+void Manager::renderBlock(int index, int id)
+{
+    Block current = tiles[index];
+    Timer timer;
+    int rowsDone = 0;
+
+    for(int y = 0; y < current.height; y += packetSize){
+        if(interruptFlag)
+            return;
+
+        int rowsLeft = (current.height - y + packetSize - 1) / packetSize;
+        if(rowsDone > 0 && timer.elapsed() / rowsDone * rowsLeft > splitTime){
+            int split = -1;
+            if(rowsLeft >= 2){
+                int keep = (rowsLeft / 2) * packetSize;
+                split = addTile(current.initX, current.initY + y + keep, current.width, current.height - y - keep);
+                if(split != -1)
+                    current.height = y + keep;
             }
+            else if(current.width >= 2 * packetSize){
+                int keep = (current.width / packetSize / 2) * packetSize;
+                split = addTile(current.initX + keep, current.initY + y, current.width - keep, current.height - y);
+                if(split != -1)
+                    current.width = keep;
+            }
+            if(split != -1)
+                queues[id]->push(split);
         }
-        if(interruptFlag)
-            break;
-        progress->blockComplete();
+
+        int height = min(packetSize, current.height - y);
+        for(int x = 0; x < current.width; x += packetSize)
+            renderTile(current.initX + x, current.initY + y, min(packetSize, current.width - x), height, id);
+        progress->pixelsComplete(current.width * height);
+        rowsDone++;
     }
+}
 
-    active.lock();
-    threadsActive--;
-    if(threadsActive == 0)
-        renderDone.notify_one();
-    active.unlock();
+//camera rays traced by all threads
+long long Manager::getRayCount(void)
+{
+    long long total = 0;
+    for(int i = 0; i < samplers.size(); i++)
+        total += samplers[i]->getRayCount();
+    return total;
 }
 
-int Manager::nextBlock(void)
+//the merged counters, only filled in when built with RAY_STATS
+RayStats& Manager::getStats(void)
 {
-    blockMutex.lock();
-    int value = currentBlock;
-    currentBlock++;
-    if(value >= numBlocks)
-        value = -1;
-    blockMutex.unlock();
-    return value;
+    return stats;
+}
+
+//with a buffer set every tile is measured, the buffer has to match the image size
+void Manager::setCostBuffer(CostBuffer* buffer)
+{
+    costs = buffer;
+
+    #ifndef RAY_STATS
+    if(costs && costs->getMode() == CostBuffer::RAYS)
+        Log::writeLine("Ray counts need a RAY_STATS build, the cost buffer measures time instead");
+    #endif // RAY_STATS
 }
 
 void Manager::setEventHandler(ProgressEvent* e)
@@ -5,10 +5,12 @@
 #include "raytracer.h"
 #include "log.h"
 #include "progress.h"
+#include "tileQueue.h"
+#include "rayStats.h"
+#include "costBuffer.h"
 
 #include <thread>
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
 
 struct Block{
     int initX;
@@ -29,32 +31,58 @@ class Manager
         void interrupt(void);
 
         void setEventHandler(ProgressEvent*);
+        void setCostBuffer(CostBuffer*);
+
+        long long getRayCount(void);
+        RayStats& getStats(void);
 
     private:
 
         int numThreads;
         vector<thread> threads;
 
-        int threadsActive;
-        mutex active;
-
         bool interruptFlag;
 
         Image* img;
         Raytracer* raytracer;
 
-        int currentBlock;
-        int numBlocks;
-        Block* blocks;
-        mutex blockMutex;
-        mutex condMutex;
-        condition_variable renderDone;
-        int nextBlock(void);
+        //every tile ever created, split tiles are appended so
+        //the queues can refer to them by index
+        vector<Block> tiles;
+        atomic<int> tileCount;
+        int addTile(int, int, int, int);
+
+        //one deque per thread and the number of tiles queued or in progress
+        vector<TileQueue*> queues;
+        atomic<int> pending;
+        bool nextTile(int, int&);
+
+        int packetSize;
+
+        //every thread samples through its own copy of the scene's sampler
+        vector<Sampler*> samplers;
+
+        //counters each thread leaves behind and their sum over the last render
+        vector<RayStats> threadStats;
+        RayStats stats;
+
+        //optional per pixel cost of the render, not owned
+        CostBuffer* costs;
 
         void basicRender(void);
         void threadedRender(int);
+        void renderBlock(int, int);
+        void renderTile(int, int, int, int, int);
+        void measureTile(int, int, int, int, Vector3*, int);
+        void traceBlock(int, int);
 
         Progress* progress;
+
+        //predicted time left in a tile before its remainder is split off
+        static constexpr float splitTime = 0.002f;
+
+        //objects listed in the statistics report
+        static const int reportedObjects = 10;
 };
 
 #endif // MANAGER_H_INCLUDED
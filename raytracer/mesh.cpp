@@ -1,61 +1,118 @@
 #include "mesh.h"
+#include "octree.h"
+#include "meshBVH.h"
 #include "raytracer.h"
+#include "timer.h"
+#include "packet.h"
 
-Mesh::Mesh(std::vector<Triangle*>* t, std::vector<Vector3>* p, std::vector<Vector3>* n)
+Mesh::Mesh(TriangleStore* t, Accelerator::Type type)
 {
     triangles = t;
-    points = p;
-    normals = n;
+    triangles->setup();
+    Log::writeLine("Mesh triangle data: " + Log::intToString(triangles->getMemoryUsage() / 1024) + " KB, " +
+                   CPU::getName() + " kernels");
 
-    if(useOctree){
-        data = new Octree(10, 10);
+    switch(type)
+    {
+        case Accelerator::OCTREE:
+            data = new Octree(10, 10);
+            break;
+        case Accelerator::SAH:
+            data = new MeshBVH(4);
+            break;
+        default:
+            data = NULL;
+            break;
+    }
+
+    if(data){
+        Timer timer;
         data->createTree(t);
+        Log::writeLine("Mesh acceleration structure: " + Log::intToString(data->getNodeCount()) + " nodes, " +
+                       Log::intToString(data->getMemoryUsage() / 1024) + " KB, built in " +
+                       Log::floatToString(timer.elapsed()) + "s");
     }
 }
 
 Mesh::~Mesh(void)
 {
     delete data;
-    delete points;
-    delete normals;
-
-    for(int i = 0; i < triangles->size(); i++)
-        delete triangles->at(i);
     delete triangles;
 }
 
-bool Mesh::Intersection(Ray& ray, Hitpoint& hit)
+//the structures cull everything beyond tMax, the triangle kernels
+//always start the interval at Ray::SMALL, so a later tMin moves the
+//origin along the ray until Ray::SMALL falls on it
+bool Mesh::Intersection(Ray& ray, Hitpoint& hit, float tMin, float tMax)
 {
-    if(useOctree){
+    float offset = tMin - Ray::SMALL;
+    if(offset > 0.0f){
+        Ray moved(ray.origin + offset * ray.dir, ray.dir);
+        if(!Intersection(moved, hit, Ray::SMALL, tMax - offset))
+            return false;
+        hit.t += offset;
+        return true;
+    }
+
+    hit.t = tMax;
+    if(data)
         return data->intersectRay(ray, hit);
+
+    //no accelerator, test every triangle
+    return triangles->intersectRange(0, triangles->size(), ray, hit);
+}
+
+bool Mesh::Occlusion(Ray& ray, float range)
+{
+    if(data)
+        return data->occludesRay(ray, range);
+
+    Hitpoint hit;
+    hit.t = range;
+    return triangles->intersectRange(0, triangles->size(), ray, hit);
+}
+
+void Mesh::PacketIntersection(RayPacket& packet, bool* found)
+{
+    if(data){
+        data->intersectPacket(packet, found);
+        return;
     }
-    else{
-        float minT = FLT_MAX;
-        Hitpoint h;
-        bool ret = false;
-        for(int i = 0; i < triangles->size(); i++){
-            if(triangles->at(i)->intersectRay(ray, h)){
-                if(h.t < minT && h.t >= Ray::SMALL){
-                    minT = h.t;
-                    intersectIndex = i;
-                }
-                ret = true;
-            }
+
+    Hitpoint hit;
+    for(int i = 0; i < packet.size; i++){
+        if(packet.active[i] && Intersection(packet.rays[i], hit, Ray::SMALL, packet.hits[i].t)){
+            packet.hits[i] = hit;
+            found[i] = true;
         }
-        hit.t = minT;
-        return ret;
     }
 }
 
+//the hit triangle and its barycentrics are cached on the ray
 Vector3 Mesh::getNormal(Ray& p)
 {
-    if(useOctree)
-        return data->getNormal(p);
-    return triangles->at(intersectIndex)->computeNormal(p);
+    return triangles->getNormal(p.cacheIndex, p.cacheFloat1, p.cacheFloat2);
+}
+
+bool Mesh::getBounds(Vector3& minBound, Vector3& maxBound)
+{
+    vector<Vector3>& points = triangles->points;
+    if(points.size() == 0)
+        return false;
+
+    minBound = points[0];
+    maxBound = points[0];
+    for(int i = 1; i < points.size(); i++){
+        Vector3& p = points[i];
+        for(int k = 0; k < 3; k++){
+            minBound.elements[k] = min(minBound.elements[k], p.elements[k]);
+            maxBound.elements[k] = max(maxBound.elements[k], p.elements[k]);
+        }
+    }
+    return true;
 }
 
 void Mesh::getUV(Vector3& point, Ray& ray, float& u, float& v)
 {
-    if(useOctree)
-        data->getUV(point, ray, u, v);
+    triangles->getUV(ray.cacheIndex, ray.cacheFloat1, ray.cacheFloat2, u, v);
 }
@@ -4,31 +4,29 @@
 #include <vector>
 #include "shape.h"
 #include "vector.h"
-#include "triangle.h"
-#include "octree.h"
+#include "triangleStore.h"
+#include "accelerator.h"
 
 class Mesh : public Shape
 {
     public:
 
-        Mesh(std::vector<Triangle*>*, std::vector<Vector3>*, std::vector<Vector3>*);
+        Mesh(TriangleStore*, Accelerator::Type);
         ~Mesh(void);
 
         void getUV(Vector3&, Ray&, float&, float&);
 
     private:
 
-        bool Intersection(Ray&, Hitpoint&);
+        bool Intersection(Ray&, Hitpoint&, float, float);
+        bool Occlusion(Ray&, float);
+        void PacketIntersection(RayPacket&, bool*);
         Vector3 getNormal(Ray&);
+        bool getBounds(Vector3&, Vector3&);
 
-        const bool useOctree = true;
+        TriangleStore* triangles;
 
-        std::vector<Triangle*>* triangles;
-        std::vector<Vector3>* points;
-        std::vector<Vector3>* normals;
-        int intersectIndex;
-
-        Octree* data;
+        Accelerator* data;
 };
 
 #endif // MESH_H_INCLUDED
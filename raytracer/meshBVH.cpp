@@ -0,0 +1,384 @@
+#include "meshBVH.h"
+#include "raytracer.h"
+#include "packet.h"
+#include "trace.h"
+
+#ifdef CPU_SSE
+#include <immintrin.h>
+#endif
+
+MeshBVH::MeshBVH(int leafSize)
+{
+    maxLeaf = leafSize;
+    triangles = NULL;
+}
+
+void MeshBVH::createTree(TriangleStore* newData)
+{
+    TraceScope scope("MeshBVH::createTree", Log::intToString(newData->size()) + " triangles");
+    triangles = newData;
+
+    vector<BVHPrimitive> primitives;
+    primitives.reserve(newData->size());
+    for(int i = 0; i < newData->size(); i++){
+        Vector3 p1, p2, p3;
+        newData->getVertices(i, p1, p2, p3);
+        Vector3 minBound, maxBound;
+        for(int k = 0; k < 3; k++){
+            minBound.elements[k] = min(min(p1.elements[k], p2.elements[k]), p3.elements[k]);
+            maxBound.elements[k] = max(max(p1.elements[k], p2.elements[k]), p3.elements[k]);
+        }
+        primitives.push_back(BVHPrimitive(minBound, maxBound, i));
+    }
+
+    BVH tree(maxLeaf);
+    tree.createTree(primitives);
+    if(tree.getNodeCount() == 0)
+        return;
+
+    //store the triangles in leaf order so every leaf is a contiguous range
+    triangles->reorder(tree.getIndices());
+
+    //the binary tree is only needed until it is collapsed
+    vector<WideNode> wideNodes;
+    wideNodes.reserve(tree.getNodeCount() / 2 + 1);
+    collapseNode(tree.getNodes(), 0, wideNodes);
+    nodes.assign(wideNodes);
+
+    Vector3 minBound, maxBound;
+    tree.getBounds(minBound, maxBound);
+    Log::writeLine("Mesh Bounds:");
+    Log::writeLine("  " + minBound.toString());
+    Log::writeLine("  " + maxBound.toString());
+}
+
+//pulls up to four descendants of a binary node into one wide node by
+//repeatedly opening the interior child with the largest surface area
+int MeshBVH::collapseNode(BVHNode* binary, int index, vector<WideNode>& outNodes)
+{
+    int slots[4] = {index};
+    int num = 1;
+
+    //a binary leaf at the root still gets a wide node holding it
+    if(binary[index].count == 0){
+        num = 0;
+        slots[num++] = index + 1;
+        slots[num++] = binary[index].offset;
+
+        while(num < 4){
+            int best = -1;
+            float bestArea = -1.0f;
+            for(int i = 0; i < num; i++){
+                BVHNode& n = binary[slots[i]];
+                if(n.count > 0)
+                    continue;
+                float dx = n.Max[0] - n.Min[0];
+                float dy = n.Max[1] - n.Min[1];
+                float dz = n.Max[2] - n.Min[2];
+                float area = dx * dy + dy * dz + dz * dx;
+                if(area > bestArea){
+                    bestArea = area;
+                    best = i;
+                }
+            }
+            if(best == -1)
+                break;
+
+            int opened = slots[best];
+            slots[best] = opened + 1;
+            slots[num++] = binary[opened].offset;
+        }
+    }
+
+    int wide = outNodes.size();
+    outNodes.push_back(WideNode());
+
+    for(int i = 0; i < 4; i++){
+        WideNode& w = outNodes[wide];
+        if(i >= num){
+            w.minX[i] = w.minY[i] = w.minZ[i] = FLT_MAX;
+            w.maxX[i] = w.maxY[i] = w.maxZ[i] = -FLT_MAX;
+            w.child[i] = 0;
+            w.count[i] = -1;
+            continue;
+        }
+
+        BVHNode& n = binary[slots[i]];
+        w.minX[i] = n.Min[0];
+        w.minY[i] = n.Min[1];
+        w.minZ[i] = n.Min[2];
+        w.maxX[i] = n.Max[0];
+        w.maxY[i] = n.Max[1];
+        w.maxZ[i] = n.Max[2];
+        w.count[i] = n.count;
+        w.child[i] = n.offset;
+    }
+
+    //children are collapsed after the parent is written, the vector may grow
+    for(int i = 0; i < num; i++){
+        if(binary[slots[i]].count == 0){
+            int child = collapseNode(binary, slots[i], outNodes);
+            outNodes[wide].child[i] = child;
+        }
+    }
+
+    return wide;
+}
+
+int MeshBVH::getNodeCount(void)
+{
+    return nodes.size();
+}
+
+size_t MeshBVH::getMemoryUsage(void)
+{
+    return nodes.getMemoryUsage();
+}
+
+//slab test of the ray against the four child boxes, returns a bit mask of
+//the children hit and writes their entry distances
+int MeshBVH::intersectChildren(WideNode& node, Vector3& origin, Vector3& invDir, float maxT, float* tNear)
+{
+#ifdef CPU_SSE
+    __m128 ox = _mm_set1_ps(origin.x);
+    __m128 oy = _mm_set1_ps(origin.y);
+    __m128 oz = _mm_set1_ps(origin.z);
+    __m128 ix = _mm_set1_ps(invDir.x);
+    __m128 iy = _mm_set1_ps(invDir.y);
+    __m128 iz = _mm_set1_ps(invDir.z);
+
+    __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix);
+    __m128 x2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+    __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy);
+    __m128 y2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+    __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz);
+    __m128 z2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+
+    //the running bound is the second operand so a NaN slab is ignored
+    __m128 tMin = _mm_setzero_ps();
+    __m128 tMax = _mm_set1_ps(maxT);
+    tMin = _mm_max_ps(_mm_min_ps(x1, x2), tMin);
+    tMax = _mm_min_ps(_mm_max_ps(x1, x2), tMax);
+    tMin = _mm_max_ps(_mm_min_ps(y1, y2), tMin);
+    tMax = _mm_min_ps(_mm_max_ps(y1, y2), tMax);
+    tMin = _mm_max_ps(_mm_min_ps(z1, z2), tMin);
+    tMax = _mm_min_ps(_mm_max_ps(z1, z2), tMax);
+
+    _mm_storeu_ps(tNear, tMin);
+    int mask = _mm_movemask_ps(_mm_cmple_ps(tMin, tMax));
+#else
+    int mask = 0;
+    float* Min[3] = {node.minX, node.minY, node.minZ};
+    float* Max[3] = {node.maxX, node.maxY, node.maxZ};
+    for(int i = 0; i < 4; i++){
+        float tMin = 0.0f;
+        float tMax = maxT;
+        for(int k = 0; k < 3; k++){
+            float t1 = (Min[k][i] - origin.elements[k]) * invDir.elements[k];
+            float t2 = (Max[k][i] - origin.elements[k]) * invDir.elements[k];
+            tMin = max(min(t1, t2), tMin);
+            tMax = min(max(t1, t2), tMax);
+        }
+        tNear[i] = tMin;
+        if(tMin <= tMax)
+            mask |= 1 << i;
+    }
+#endif
+
+    //empty slots never count as hit
+    for(int i = 0; i < 4; i++){
+        if(node.count[i] < 0)
+            mask &= ~(1 << i);
+    }
+    return mask;
+}
+
+bool MeshBVH::intersectRay(Ray& ray, Hitpoint& Hit)
+{
+    if(nodes.size() == 0)
+        return false;
+
+    Vector3 invDir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+
+    bool intersect = false;
+
+    //entries are wide nodes, or triangle ranges when the count is positive
+    int stack[maxStack];
+    int stackCount[maxStack];
+    float stackT[maxStack];
+    int top = 0;
+    stack[top] = 0;
+    stackCount[top] = 0;
+    stackT[top++] = 0.0f;
+
+    while(top > 0){
+        top--;
+        if(stackT[top] > Hit.t)
+            continue;
+
+        if(stackCount[top] > 0){
+            if(triangles->intersectRange(stack[top], stackCount[top], ray, Hit))
+                intersect = true;
+            continue;
+        }
+
+        WideNode& node = nodes[stack[top]];
+        float tNear[4];
+        int mask = intersectChildren(node, ray.origin, invDir, Hit.t, tNear);
+
+        //order the hit children far to near so the nearest is popped first
+        int order[4];
+        int num = 0;
+        for(int i = 0; i < 4; i++){
+            if(!(mask & (1 << i)))
+                continue;
+            int j = num++;
+            while(j > 0 && tNear[order[j - 1]] < tNear[i]){
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = i;
+        }
+
+        for(int i = 0; i < num; i++){
+            int c = order[i];
+            stack[top] = node.child[c];
+            stackCount[top] = node.count[c];
+            stackT[top++] = tNear[c];
+        }
+    }
+
+    return intersect;
+}
+
+//any hit closer than range ends the walk, so the children are
+//visited in whatever order they come
+bool MeshBVH::occludesRay(Ray& ray, float range)
+{
+    if(nodes.size() == 0)
+        return false;
+
+    Vector3 invDir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+    Hitpoint Hit;
+    Hit.t = range;
+
+    int stack[maxStack];
+    int stackCount[maxStack];
+    int top = 0;
+    stack[top] = 0;
+    stackCount[top++] = 0;
+
+    while(top > 0){
+        top--;
+        if(stackCount[top] > 0){
+            if(triangles->intersectRange(stack[top], stackCount[top], ray, Hit))
+                return true;
+            continue;
+        }
+
+        WideNode& node = nodes[stack[top]];
+        float tNear[4];
+        int mask = intersectChildren(node, ray.origin, invDir, range, tNear);
+        for(int c = 0; c < 4; c++){
+            if(mask & (1 << c)){
+                stack[top] = node.child[c];
+                stackCount[top++] = node.count[c];
+            }
+        }
+    }
+
+    return false;
+}
+
+//traverses the tree once for the whole packet, every stack entry carries
+//the mask of rays that entered the node so each ray is still culled by
+//its own closest hit, the frustum test rejects nodes for all rays at once
+void MeshBVH::intersectPacket(RayPacket& packet, bool* found)
+{
+    if(nodes.size() == 0)
+        return;
+    if(!packet.coherent){
+        Accelerator::intersectPacket(packet, found);
+        return;
+    }
+
+    //entries are wide nodes, or triangle ranges when the count is positive
+    int stack[maxStack];
+    int stackCount[maxStack];
+    uint64_t stackMask[maxStack];
+    int top = 0;
+    stack[top] = 0;
+    stackCount[top] = 0;
+    stackMask[top] = 0;
+    for(int i = 0; i < packet.size; i++){
+        if(packet.active[i])
+            stackMask[top] |= (uint64_t)1 << i;
+    }
+    top++;
+
+    while(top > 0){
+        top--;
+        uint64_t mask = stackMask[top];
+
+        if(stackCount[top] > 0){
+            for(int i = 0; i < packet.size; i++){
+                if((mask >> i) & 1){
+                    if(triangles->intersectRange(stack[top], stackCount[top], packet.rays[i], packet.hits[i]))
+                        found[i] = true;
+                }
+            }
+            continue;
+        }
+
+        WideNode& node = nodes[stack[top]];
+
+        //children outside the packet's frustum are skipped by every ray
+        int possible = 0;
+        float maxT = packet.getMaxT();
+        for(int c = 0; c < 4; c++){
+            float Min[3] = {node.minX[c], node.minY[c], node.minZ[c]};
+            float Max[3] = {node.maxX[c], node.maxY[c], node.maxZ[c]};
+            float tNear;
+            if(node.count[c] >= 0 && packet.intersectBox(Min, Max, maxT, tNear))
+                possible |= 1 << c;
+        }
+        if(possible == 0)
+            continue;
+
+        uint64_t childMask[4] = {0, 0, 0, 0};
+        float childT[4] = {FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX};
+        for(int i = 0; i < packet.size; i++){
+            if(!((mask >> i) & 1))
+                continue;
+            float tNear[4];
+            int hits = intersectChildren(node, packet.rays[i].origin, packet.invDir[i], packet.hits[i].t, tNear) & possible;
+            for(int c = 0; c < 4; c++){
+                if(hits & (1 << c)){
+                    childMask[c] |= (uint64_t)1 << i;
+                    childT[c] = min(childT[c], tNear[c]);
+                }
+            }
+        }
+
+        //far to near so the nearest child is popped first
+        int order[4];
+        int num = 0;
+        for(int c = 0; c < 4; c++){
+            if(childMask[c] == 0)
+                continue;
+            int j = num++;
+            while(j > 0 && childT[order[j - 1]] < childT[c]){
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = c;
+        }
+
+        for(int i = 0; i < num; i++){
+            int c = order[i];
+            stack[top] = node.child[c];
+            stackCount[top] = node.count[c];
+            stackMask[top++] = childMask[c];
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef MESHBVH_H_INCLUDED
+#define MESHBVH_H_INCLUDED
+
+#include <vector>
+#include <stdint.h>
+#include "accelerator.h"
+#include "bvh.h"
+#include "triangleStore.h"
+#include "aligned.h"
+#include "cpu.h"
+#include "log.h"
+
+//four children of a collapsed node, the boxes are stored per axis so a
+//ray is tested against all of them at once, a node is two cache lines
+struct WideNode
+{
+    float minX[4], minY[4], minZ[4];
+    float maxX[4], maxY[4], maxZ[4];
+    int child[4];   //child node, or first triangle for leaves
+    int count[4];   //triangles in a leaf, 0 for interior nodes, -1 for empty slots
+};
+
+class MeshBVH : public Accelerator
+{
+    public:
+
+        MeshBVH(int);
+
+        void createTree(TriangleStore*);
+        bool intersectRay(Ray&, Hitpoint&);
+        bool occludesRay(Ray&, float);
+        void intersectPacket(RayPacket&, bool*);
+
+        int getNodeCount(void);
+        size_t getMemoryUsage(void);
+
+        static const int maxStack = 256;
+
+    private:
+
+        int collapseNode(BVHNode*, int, vector<WideNode>&);
+        int intersectChildren(WideNode&, Vector3&, Vector3&, float, float*);
+
+        TriangleStore* triangles;
+
+        AlignedArray<WideNode> nodes;
+
+        int maxLeaf;
+};
+
+#endif // MESHBVH_H_INCLUDED
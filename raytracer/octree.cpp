@@ -1,20 +1,23 @@
 #include "octree.h"
-#include "triangle.h"
 #include "raytracer.h"
+#include "trace.h"
+#include <thread>
 
 Octree::Octree(int data, int depth)
 {
     maxData = data;
     maxDepth = depth;
-    root = NULL;
+    triangles = NULL;
+
+    //split into parallel tasks until every hardware thread has a subtree
+    int threads = max((int)std::thread::hardware_concurrency(), 1);
+    parallelDepth = 1;
+    for(int tasks = 8; tasks < threads; tasks *= 8)
+        parallelDepth++;
 }
 
 Octree::~Octree(void)
-{
-    deleteTree(root);
-    delete root;
-    root = NULL;
-}
+{}
 
 void Octree::deleteTree(Node* n)
 {
@@ -39,35 +42,80 @@ void Octree::computeNum(Node* n)
     }
 }
 
-void Octree::createTree(vector<Triangle*>* newData)
+int Octree::getNodeCount(void)
 {
-    computeBounds(*newData, minBound, maxBound);
+    return nodes.size();
+}
+
+size_t Octree::getMemoryUsage(void)
+{
+    return nodes.getMemoryUsage() + packedTriangles.getMemoryUsage();
+}
 
-    root = new Node();
+void Octree::createTree(TriangleStore* newData)
+{
+    TraceScope scope("Octree::createTree", Log::intToString(newData->size()) + " triangles");
+    triangles = newData;
+    computeBounds(minBound, maxBound);
+
+    vector<int> all(newData->size());
+    for(int i = 0; i < all.size(); i++)
+        all[i] = i;
+
+    Node* root = new Node();
     root->children = NULL;
-    root->parent = NULL;
 
-    insertTriangles(*newData, minBound, maxBound, root, 1);
+    insertTriangles(all, minBound, maxBound, root, 1);
     computeNum(root);
 
+    //serialize the tree into the contiguous arrays used for traversal
+    vector<OctreeNode> flatNodes(1);
+    vector<int> flatTriangles;
+    flattenTree(root, 0, flatNodes, flatTriangles);
+    nodes.assign(flatNodes);
+    packedTriangles.assign(flatTriangles);
+
+    deleteTree(root);
+    delete root;
+
     Log::writeLine("Mesh Bounds:");
     Log::writeLine("  " + minBound.toString());
     Log::writeLine("  " + maxBound.toString());
 }
 
-void Octree::insertTriangles(vector<Triangle*>& triangles, Vector3 minCorner, Vector3 maxCorner, Node* current, int depth)
+//writes the node at the given index, reserving consecutive slots for its children
+void Octree::flattenTree(Node* n, int index, vector<OctreeNode>& flatNodes, vector<int>& flatTriangles)
+{
+    flatNodes[index].num = n->num;
+
+    if(n->children == NULL){
+        flatNodes[index].children = -1;
+        flatNodes[index].first = flatTriangles.size();
+        flatNodes[index].count = n->data.size();
+        flatTriangles.insert(flatTriangles.end(), n->data.begin(), n->data.end());
+        return;
+    }
+
+    int first = flatNodes.size();
+    flatNodes[index].children = first;
+    flatNodes[index].first = 0;
+    flatNodes[index].count = 0;
+    flatNodes.resize(first + 8);
+
+    for(int i = 0; i < 8; i++)
+        flattenTree(&n->children[i], first + i, flatNodes, flatTriangles);
+}
+
+void Octree::insertTriangles(vector<int>& triangles, Vector3 minCorner, Vector3 maxCorner, Node* current, int depth)
 {
     if(depth >= maxDepth || triangles.size() <= maxData){
-        for(int i = 0; i < triangles.size(); i++)
-            current->data.push_back(triangles[i]);
+        current->data = triangles;
         return;
     }
 
     current->children = new Node[8];
-    for(int i = 0; i < 8; i++){
+    for(int i = 0; i < 8; i++)
         current->children[i].children = NULL;
-        current->children[i].parent = current;
-    }
 
     Vector3 midPoint = (minCorner + maxCorner) * 0.5;
 
@@ -81,21 +129,53 @@ void Octree::insertTriangles(vector<Triangle*>& triangles, Vector3 minCorner, Ve
     for(int i = 0; i < 8; i++)
         computePoints(points[i], bounds[i], bounds[i + 7]);
 
-    vector<Triangle*> groups[8];
-    vector<Triangle*>::iterator it;
-    for(it = triangles.begin(); it != triangles.end(); it++){
-        for(int j = 0; j < 8; j++){
-            if(triangleAABBIntersect(*it, points[j]))
-                groups[j].push_back(*it);
-        }
+    //every child only reads the parent's triangles and writes its own
+    //subtree, so the upper levels are built as parallel tasks
+    if(depth <= parallelDepth && triangles.size() >= parallelThreshold){
+        vector<thread> workers;
+        for(int i = 0; i < 8; i++)
+            workers.push_back(thread(&Octree::insertChild, this, std::ref(triangles), points[i], bounds[i], bounds[i + 7], &current->children[i], depth + 1));
+        for(int i = 0; i < 8; i++)
+            workers[i].join();
     }
+    else{
+        for(int i = 0; i < 8; i++)
+            insertChild(triangles, points[i], bounds[i], bounds[i + 7], &current->children[i], depth + 1);
+    }
+}
 
-    for(int i = 0; i < 8; i++)
-        insertTriangles(groups[i], Vector3(bounds[i][0], bounds[i][1], bounds[i][2]), Vector3(bounds[i + 7][0], bounds[i + 7][1], bounds[i + 7][2]), &current->children[i], depth + 1);
+//collects the triangles overlapping a child and builds its subtree
+void Octree::insertChild(vector<int>& parentTriangles, Vector3* points, float* minCorner, float* maxCorner, Node* child, int depth)
+{
+    vector<int> group;
+    for(int i = 0; i < parentTriangles.size(); i++){
+        if(triangleAABBIntersect(parentTriangles[i], points))
+            group.push_back(parentTriangles[i]);
+    }
+
+    insertTriangles(group, Vector3(minCorner[0], minCorner[1], minCorner[2]), Vector3(maxCorner[0], maxCorner[1], maxCorner[2]), child, depth);
 }
 
 bool Octree::intersectRay(Ray& ray, Hitpoint& h)
 {
+    return traverse(ray, h, false);
+}
+
+//any triangle closer than range will do, the walk ends at the first one
+bool Octree::occludesRay(Ray& ray, float range)
+{
+    Hitpoint h;
+    h.t = range;
+    return traverse(ray, h, true);
+}
+
+//walks the subtrees the ray passes through front to back, only hits
+//closer than h.t count
+bool Octree::traverse(Ray& ray, Hitpoint& h, bool anyHit)
+{
+    if(nodes.size() == 0)
+        return false;
+
     char vmask = 0;
 
     BoundInfo b;
@@ -141,11 +221,8 @@ bool Octree::intersectRay(Ray& ray, Hitpoint& h)
 
     b.lmax = max(max(b.Min[0], b.Min[1]), b.Min[2]);
     b.umin = min(min(b.Max[0], b.Max[1]), b.Max[2]);
-    if(b.lmax < b.umin){
-        h.t = DBL_MAX;
-
-        return intersectSubTrees(ray, h, root, b, vmask);
-    }
+    if(b.lmax < b.umin && b.lmax < h.t)
+        return intersectSubTrees(ray, h, 0, b, vmask, anyHit);
     return false;
 }
 
@@ -185,23 +262,13 @@ void Octree::computeIntersectRange(char mask, BoundInfo& b, float* Min, float* M
     b.umin = min(min(b.Max[0], b.Max[1]), b.Max[2]);
 }
 
-bool Octree::intersectSubTrees(Ray& ray, Hitpoint& Hit, Node* current, BoundInfo& b, char vmask)
+bool Octree::intersectSubTrees(Ray& ray, Hitpoint& Hit, int index, BoundInfo& b, char vmask, bool anyHit)
 {
-    if(current->children == NULL){
-        bool intersect = false;
-        Hitpoint h;
-        for(int i = 0; i < current->data.size(); i++){
-            if(current->data[i]->intersectRay(ray, h)){
-                intersect = true;
-                if(h.t > Ray::SMALL && h.t < Hit.t){
-                    Hit.t = h.t;
-                    Hit.s = current->data[i];
-                    Hit.f1 = h.f1;
-                    Hit.f2 = h.f2;
-                }
-            }
-        }
-        return intersect;
+    OctreeNode& current = nodes[index];
+    if(current.children == -1){
+        if(current.count == 0)
+            return false;
+        return triangles->intersectList(&packedTriangles[current.first], current.count, ray, Hit);
     }
 
     float midX = (b.Min[0] + b.Max[0]) / 2.0;
@@ -254,14 +321,16 @@ bool Octree::intersectSubTrees(Ray& ray, Hitpoint& Hit, Node* current, BoundInfo
     bool intersect = false;
     int i = 0;
     do{
-        if(current->children[cmask ^ vmask].num > 0){
+        int child = current.children + (cmask ^ vmask);
+        if(nodes[child].num > 0){
             BoundInfo childBound;
             computeIntersectRange(cmask, childBound, b.Min, Mid, b.Max);
 
-            if(childBound.lmax < childBound.umin){
-                if(intersectSubTrees(ray, Hit, &current->children[cmask ^ vmask], childBound, vmask)){
+            //children entered beyond the current hit can not hold a closer one
+            if(childBound.lmax < childBound.umin && childBound.lmax < Hit.t){
+                if(intersectSubTrees(ray, Hit, child, childBound, vmask, anyHit)){
                     intersect = true;
-                    if(Hit.t < childBound.umin)
+                    if(anyHit || Hit.t < childBound.umin)
                         break;
                 }
             }
@@ -280,35 +349,24 @@ bool Octree::intersectSubTrees(Ray& ray, Hitpoint& Hit, Node* current, BoundInfo
     return intersect;
 }
 
-void Octree::computeBounds(vector<Triangle*> triangles, Vector3& minBound, Vector3& maxBound)
+void Octree::computeBounds(Vector3& minBound, Vector3& maxBound)
 {
-    if(triangles.size() == 0)
+    vector<Vector3>& points = triangles->points;
+    if(triangles->size() == 0)
         return;
 
-    Vector3* p1 = triangles[0]->p1;
-    Vector3* p2 = triangles[0]->p1;
-    Vector3* p3 = triangles[0]->p1;
-
-    minBound.x = triangles[0]->p1->x;
-    minBound.y = triangles[0]->p1->y;
-    minBound.z = triangles[0]->p1->z;
+    minBound = points[0];
+    maxBound = points[0];
 
-    maxBound.x = triangles[0]->p1->x;
-    maxBound.y = triangles[0]->p1->y;
-    maxBound.z = triangles[0]->p1->z;
-
-    for(int i = 0; i < triangles.size(); i++){
-        p1 = triangles[i]->p1;
-        p2 = triangles[i]->p2;
-        p3 = triangles[i]->p3;
-        minBound.x = min(min(min(minBound.x, p1->x), p2->x), p3->x);
-        maxBound.x = max(max(max(maxBound.x, p1->x), p2->x), p3->x);
-
-        minBound.y = min(min(min(minBound.y, p1->y), p2->y), p3->y);
-        maxBound.y = max(max(max(maxBound.y, p1->y), p2->y), p3->y);
-
-        minBound.z = min(min(min(minBound.z, p1->z), p2->z), p3->z);
-        maxBound.z = max(max(max(maxBound.z, p1->z), p2->z), p3->z);
+    Vector3 p[3];
+    for(int i = 0; i < triangles->size(); i++){
+        triangles->getVertices(i, p[0], p[1], p[2]);
+        for(int j = 0; j < 3; j++){
+            for(int k = 0; k < 3; k++){
+                minBound.elements[k] = min(minBound.elements[k], p[j].elements[k]);
+                maxBound.elements[k] = max(maxBound.elements[k], p[j].elements[k]);
+            }
+        }
     }
 
     minBound -= Vector3(0.01, 0.01, 0.01);
@@ -327,11 +385,13 @@ void Octree::computePoints(Vector3* points, float* minCorner, float* maxCorner)
     points[7] = Vector3(maxCorner[0], maxCorner[1], maxCorner[2]);
 }
 
-bool Octree::triangleAABBIntersect(Triangle* triangle, Vector3* points)
+bool Octree::triangleAABBIntersect(int index, Vector3* points)
 {
-    Vector3& p1 = *triangle->p1;
-    Vector3& p2 = *triangle->p2;
-    Vector3& p3 = *triangle->p3;
+    Vector3 triangle[3];
+    triangles->getVertices(index, triangle[0], triangle[1], triangle[2]);
+    Vector3& p1 = triangle[0];
+    Vector3& p2 = triangle[1];
+    Vector3& p3 = triangle[2];
     if(pointInAABB(p1, points[0], points[7]) || pointInAABB(p2, points[0], points[7]) || pointInAABB(p3, points[0], points[7]))
         return true;
 
@@ -345,7 +405,8 @@ bool Octree::triangleAABBIntersect(Triangle* triangle, Vector3* points)
         }
     }
 
-    Vector3 n = triangle->getPlanarNormal();
+    Vector3 n = Vector3::CrossProduct(p3 - p1, p2 - p1);
+    n.normalize();
     projectTriangle(triangle, n, t1, t2);
     projectAABB(3, points, n, s1, s2);
     if(!intervalsOverlap(t1, t2, s1, s2))
@@ -365,11 +426,11 @@ bool Octree::triangleAABBIntersect(Triangle* triangle, Vector3* points)
     return true;
 }
 
-void Octree::projectTriangle(Triangle* triangle, Vector3& axis, float& t1, float& t2)
+void Octree::projectTriangle(Vector3* triangle, Vector3& axis, float& t1, float& t2)
 {
-    Vector3& p1 = *triangle->p1;
-    Vector3& p2 = *triangle->p2;
-    Vector3& p3 = *triangle->p3;
+    Vector3& p1 = triangle[0];
+    Vector3& p2 = triangle[1];
+    Vector3& p3 = triangle[2];
     t1 = Vector3::DotProduct(axis, p1);
     t2 = t1;
     float nextT = Vector3::DotProduct(axis, p2);
@@ -422,13 +483,3 @@ bool Octree::pointInAABB(Vector3& point, Vector3& minCorner, Vector3& maxCorner)
         return false;
     return true;
 }
-
-Vector3 Octree::getNormal(Ray& ray)
-{
-    return ray.cacheShape->computeNormal(ray);
-}
-
-void Octree::getUV(Vector3& p, Ray& ray, float& u, float& v)
-{
-    ray.cacheShape->getUV(p, ray, u, v);
-}
@@ -5,17 +5,29 @@
 #include "vector.h"
 #include "ray.h"
 #include "box.h"
+#include "accelerator.h"
+#include "aligned.h"
+#include "triangleStore.h"
 #include "debug.h"
 #include "log.h"
 
-class Triangle;
-
+//node of the tree while it is being built
 struct Node
 {
     int num;
-    Node* parent;
     Node* children;
-    vector<Triangle*> data;
+    vector<int> data;
+};
+
+//node of the flattened tree, the eight children of a node are stored
+//next to each other and a leaf's triangles are a range of the packed
+//index array, four nodes fit in a cache line
+struct OctreeNode
+{
+    int children;   //index of the first child, -1 for leaves
+    int first;      //first packed triangle index
+    int count;      //triangles in the leaf
+    int num;        //triangles in the whole subtree
 };
 
 struct BoundInfo
@@ -26,41 +38,53 @@ struct BoundInfo
     float umin;
 };
 
-class Octree
+class Octree : public Accelerator
 {
     public:
 
         Octree(int, int);
         ~Octree(void);
 
-        void createTree(vector<Triangle*>*);
+        void createTree(TriangleStore*);
         bool intersectRay(Ray&, Hitpoint&);
-        Vector3 getNormal(Ray&);
-        void getUV(Vector3&, Ray&, float&, float&);
+        bool occludesRay(Ray&, float);
+
+        int getNodeCount(void);
+        size_t getMemoryUsage(void);
 
     private:
 
-        bool triangleAABBIntersect(Triangle*, Vector3*);
-        void projectTriangle(Triangle*, Vector3&, float&, float&);
+        bool triangleAABBIntersect(int, Vector3*);
+        void projectTriangle(Vector3*, Vector3&, float&, float&);
         void projectAABB(int, Vector3*, Vector3&, float&, float&);
         bool intervalsOverlap(float, float, float, float);
         bool pointInAABB(Vector3&, Vector3&, Vector3&);
 
-        void insertTriangles(vector<Triangle*>&, Vector3, Vector3, Node*, int);
-        void createNodes(Node*);
+        void insertTriangles(vector<int>&, Vector3, Vector3, Node*, int);
+        void insertChild(vector<int>&, Vector3*, float*, float*, Node*, int);
 
-        void computeBounds(vector<Triangle*>, Vector3&, Vector3&);
+        void computeBounds(Vector3&, Vector3&);
         void computePoints(Vector3*, float*, float*);
         void computeNum(Node*);
         void computeIntersectRange(char, BoundInfo&, float*, float*, float*);
 
-        bool intersectSubTrees(Ray&, Hitpoint&, Node*, BoundInfo&, char);
+        void flattenTree(Node*, int, vector<OctreeNode>&, vector<int>&);
+
+        bool traverse(Ray&, Hitpoint&, bool);
+        bool intersectSubTrees(Ray&, Hitpoint&, int, BoundInfo&, char, bool);
 
         void deleteTree(Node*);
 
-        Node* root;
+        TriangleStore* triangles;
+
+        AlignedArray<OctreeNode> nodes;
+        AlignedArray<int> packedTriangles;
+
         int maxData;
         int maxDepth;
+        int parallelDepth;
+
+        static const int parallelThreshold = 4096;
 
         Vector3 minBound;
         Vector3 maxBound;
@@ -0,0 +1,74 @@
+#include "packet.h"
+
+//computes the inverse directions and the bounds used by the frustum test
+void RayPacket::setup(void)
+{
+    for(int k = 0; k < 3; k++){
+        originMin[k] = FLT_MAX;
+        originMax[k] = -FLT_MAX;
+        invDirMin[k] = FLT_MAX;
+        invDirMax[k] = -FLT_MAX;
+    }
+
+    coherent = true;
+    int sign[3] = {0, 0, 0};
+    for(int i = 0; i < size; i++){
+        Ray& r = rays[i];
+        invDir[i] = Vector3(1.0f / r.dir.x, 1.0f / r.dir.y, 1.0f / r.dir.z);
+        if(!active[i])
+            continue;
+
+        for(int k = 0; k < 3; k++){
+            originMin[k] = min(originMin[k], r.origin.elements[k]);
+            originMax[k] = max(originMax[k], r.origin.elements[k]);
+            invDirMin[k] = min(invDirMin[k], invDir[i].elements[k]);
+            invDirMax[k] = max(invDirMax[k], invDir[i].elements[k]);
+
+            int s = r.dir.elements[k] > 0.0f ? 1 : (r.dir.elements[k] < 0.0f ? -1 : 0);
+            if(s == 0 || (sign[k] != 0 && s != sign[k]))
+                coherent = false;
+            sign[k] = s;
+        }
+    }
+}
+
+//largest closest hit distance of the active rays
+float RayPacket::getMaxT(void)
+{
+    float maxT = 0.0f;
+    for(int i = 0; i < size; i++){
+        if(active[i] && hits[i].t > maxT)
+            maxT = hits[i].t;
+    }
+    return maxT;
+}
+
+//interval arithmetic slab test, fails only if no active ray of the packet
+//can hit the box closer than maxT, tNear is a lower bound of the entry
+bool RayPacket::intersectBox(const float* Min, const float* Max, float maxT, float& tNear)
+{
+    float tMin = 0.0f;
+    float tMax = maxT;
+    for(int k = 0; k < 3; k++){
+        //with a constant direction sign the near and far planes are shared
+        float nearPlane = invDirMin[k] > 0.0f ? Min[k] : Max[k];
+        float farPlane = invDirMin[k] > 0.0f ? Max[k] : Min[k];
+
+        float n1 = (nearPlane - originMax[k]) * invDirMin[k];
+        float n2 = (nearPlane - originMax[k]) * invDirMax[k];
+        float n3 = (nearPlane - originMin[k]) * invDirMin[k];
+        float n4 = (nearPlane - originMin[k]) * invDirMax[k];
+        float f1 = (farPlane - originMax[k]) * invDirMin[k];
+        float f2 = (farPlane - originMax[k]) * invDirMax[k];
+        float f3 = (farPlane - originMin[k]) * invDirMin[k];
+        float f4 = (farPlane - originMin[k]) * invDirMax[k];
+
+        tMin = max(tMin, min(min(n1, n2), min(n3, n4)));
+        tMax = min(tMax, max(max(f1, f2), max(f3, f4)));
+        if(tMin > tMax)
+            return false;
+    }
+
+    tNear = tMin;
+    return true;
+}
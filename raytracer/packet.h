@@ -0,0 +1,40 @@
+#ifndef PACKET_H_INCLUDED
+#define PACKET_H_INCLUDED
+
+#include "vector.h"
+#include "ray.h"
+#include "raytracer.h"
+
+//a group of coherent rays, such as the primary rays of a tile, that are
+//traversed through the acceleration structures together
+struct RayPacket
+{
+    static const int maxSize = 64;
+
+    int size;
+    Ray rays[maxSize];
+    Vector3 invDir[maxSize];
+
+    //closest hit of every ray and the object it belongs to
+    Hitpoint hits[maxSize];
+    Shape* shapes[maxSize];
+
+    //rays that still take part in the current test
+    bool active[maxSize];
+
+    void setup(void);
+    float getMaxT(void);
+    bool intersectBox(const float*, const float*, float, float&);
+
+    //every direction component keeps its sign across the active
+    //rays, the frustum test is only valid for such packets
+    bool coherent;
+
+    //bounds of the active rays used by the frustum test
+    float originMin[3];
+    float originMax[3];
+    float invDirMin[3];
+    float invDirMax[3];
+};
+
+#endif // PACKET_H_INCLUDED
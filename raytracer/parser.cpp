@@ -1,5 +1,6 @@
 #include "parser.h"
 #include "raytracer.h"
+#include "trace.h"
 
 Parser::Parser(Raytracer* r)
 {
@@ -22,15 +23,10 @@ void trimString( string & str ) {
     str.erase(location + 1);
 }
 
-bool Parser::loadObj(string fileName, vector<Triangle*>& faces, vector<Vector3>& points, vector<Vector3>& normals)
+bool Parser::loadObj(string fileName, TriangleStore& mesh)
 {
+    TraceScope scope("loadObj", fileName);
     Log::writeLine("loading mesh: " + fileName);
-    vector<Vector3> texCoords;
-    vector<float> texU;
-    vector<float> texV;
-
-    int sp = points.capacity();
-
     int nFaces = 0;
 
     ifstream objStream(fileName.c_str(), std::ios::in);
@@ -56,16 +52,16 @@ bool Parser::loadObj(string fileName, vector<Triangle*>& faces, vector<Vector3>&
             if (token == "v" ) {
                 float x, y, z;
                 lineStream >> x >> y >> z;
-                points.push_back( Vector3(x,y,z) );
+                mesh.points.push_back( Vector3(x,y,z) );
             } else if (token == "vt") {
                 // Process texture coordinate
                 float s,t;
                 lineStream >> s >> t;
-                texCoords.push_back( Vector3(s,t,0) );
+                mesh.texCoords.push_back( Vector3(s,t,0) );
             } else if (token == "vn" ) {
                 float x, y, z;
                 lineStream >> x >> y >> z;
-                normals.push_back( Vector3(x,y,z) );
+                mesh.normals.push_back( Vector3(x,y,z) );
             } else if (token == "f" ) {
                 nFaces++;
 
@@ -103,85 +99,33 @@ bool Parser::loadObj(string fileName, vector<Triangle*>& faces, vector<Vector3>&
                 }
                 // If number of edges in face is greater than 3,
                 // decompose into triangles as a triangle fan.
-                if(faceNormal.size() == face.size()){
-                    if( face.size() > 3 ) {
-                        int v0 = face[0];
-                        int v1 = face[1];
-                        int v2 = face[2];
-
-                        int n0 = faceNormal[0];
-                        int n1 = faceNormal[1];
-                        int n2 = faceNormal[2];
-
-                        int tc0, tc1, tc2;
-                        if(faceTex.size() > 3){
-                            tc0 = faceTex[0];
-                            tc1 = faceTex[1];
-                            tc2 = faceTex[2];
-                        }
-                        // First face
-                        Triangle* newTri = new Triangle(&points[v0], &points[v2], &points[v1], false);
-
-                        int maxNormal = normals.size() - 1;
-                        if(n0 > maxNormal || n1 > maxNormal || n2 > maxNormal){
-                            Log::writeLine("Invalid normal index");
-                            return false;
-                        }
-                        newTri->setNormals(&normals[n0], &normals[n2], &normals[n1]);
-                        if(faceTex.size() > 3)
-                                newTri->setUV(texCoords[tc0], texCoords[tc2], texCoords[tc1]);
-                        faces.push_back(newTri);
-                        for( int i = 3; i < face.size(); i++ ) {
-                            v1 = v2;
-                            v2 = face[i];
-                            n1 = n2;
-                            n2 = faceNormal[i];
-                            if(faceTex.size() > 3){
-                                tc1 = tc2;
-                                tc2 = faceTex[i];
-                            }
-                            newTri = new Triangle(&points[v0], &points[v2], &points[v1], false);
-
-                            if(n0 > maxNormal || n1 > maxNormal || n2 > maxNormal){
-                                Log::writeLine("Invalid normal index");
-                                return false;
-                            }
-
-                            newTri->setNormals(&normals[n0], &normals[n2], &normals[n1]);
-                            if(faceTex.size() > 3)
-                                newTri->setUV(texCoords[tc0], texCoords[tc2], texCoords[tc1]);
-                            faces.push_back(newTri);
-                        }
-                    } else {
-                        Triangle* newTri = new Triangle(&points[face[0]], &points[face[2]], &points[face[1]], false);
+                bool hasNormals = faceNormal.size() == face.size();
+                bool hasTex = hasNormals && faceTex.size() == face.size();
 
-                        int maxNormal = normals.size() - 1;
-                        if(faceNormal[0] > maxNormal || faceNormal[1] > maxNormal || faceNormal[1] > maxNormal){
+                if(hasNormals){
+                    int maxNormal = mesh.normals.size() - 1;
+                    for(int i = 0; i < faceNormal.size(); i++){
+                        if(faceNormal[i] > maxNormal){
                             Log::writeLine("Invalid normal index");
                             return false;
                         }
-
-                        newTri->setNormals(&normals[faceNormal[0]], &normals[faceNormal[2]], &normals[faceNormal[1]]);
-                        if(faceTex.size() == 3)
-                            newTri->setUV(texCoords[faceTex[0]], texCoords[faceTex[2]], texCoords[faceTex[1]]);
-                        faces.push_back(newTri);
                     }
                 }
-                else{
-                    if( face.size() > 3 ) {
-                        int v0 = face[0];
-                        int v1 = face[1];
-                        int v2 = face[2];
-                        // First face
-                        faces.push_back(new Triangle(&points[v0], &points[v2], &points[v1], false));
-                        for( int i = 3; i < face.size(); i++ ) {
-                            v1 = v2;
-                            v2 = face[i];
-                            faces.push_back(new Triangle(&points[v0], &points[v2], &points[v1], false));
-                        }
-                    } else {
-                        faces.push_back(new Triangle(&points[face[0]], &points[face[2]], &points[face[1]], false));
+
+                for(int i = 2; i < face.size(); i++){
+                    int v[3] = {face[0], face[i], face[i - 1]};
+                    int n[3], tc[3];
+                    if(hasNormals){
+                        n[0] = faceNormal[0];
+                        n[1] = faceNormal[i];
+                        n[2] = faceNormal[i - 1];
+                    }
+                    if(hasTex){
+                        tc[0] = faceTex[0];
+                        tc[1] = faceTex[i];
+                        tc[2] = faceTex[i - 1];
                     }
+                    mesh.addTriangle(v, hasNormals ? n : NULL, hasTex ? tc : NULL);
                 }
             }
         }
@@ -191,11 +135,11 @@ bool Parser::loadObj(string fileName, vector<Triangle*>& faces, vector<Vector3>&
     objStream.close();
 
     Log::writeLine("Loaded mesh from: " + fileName);
-    Log::writeLine(" " + Log::intToString(points.size()) + " points");
+    Log::writeLine(" " + Log::intToString(mesh.points.size()) + " points");
     Log::writeLine(" " + Log::intToString(nFaces) + " faces");
-    Log::writeLine(" " + Log::intToString(faces.size()) + " triangles");
-    Log::writeLine(" " + Log::intToString(normals.size()) + " normals");
-    Log::writeLine(" " + Log::intToString(texCoords.size()) + " texture coordinates");
+    Log::writeLine(" " + Log::intToString(mesh.size()) + " triangles");
+    Log::writeLine(" " + Log::intToString(mesh.normals.size()) + " normals");
+    Log::writeLine(" " + Log::intToString(mesh.texCoords.size()) + " texture coordinates");
 
     return true;
 }
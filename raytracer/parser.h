@@ -8,7 +8,7 @@
 #include <cstdlib>
 
 #include "sceneParser.h"
-#include "triangle.h"
+#include "triangleStore.h"
 
 class Raytracer;
 struct Config;
@@ -22,7 +22,7 @@ class Parser
         Parser(Raytracer*);
 
         bool loadScene(string, Config&);
-        bool loadObj(string, vector<Triangle*>&, vector<Vector3>&, vector<Vector3>&);
+        bool loadObj(string, TriangleStore&);
 
     private:
 
@@ -1,4 +1,6 @@
 #include "photonMap.h"
+#include "rayStats.h"
+#include "trace.h"
 
 PhotonMap::PhotonMap(void)
 {
@@ -7,6 +9,7 @@ PhotonMap::PhotonMap(void)
 
 void PhotonMap::setup(void)
 {
+    TraceScope scope("PhotonMap::setup", Log::intToString(photons.size()) + " photons");
     std::vector<Photon*> dataSet;
     for(int i = 0; i < photons.size(); i++)
         dataSet.push_back(&photons[i]);
@@ -103,6 +106,9 @@ void PhotonMap::nearestN(Vector3& pos, Vector3& normal, std::vector<Photon*>& re
     near.radiusSqr = radius * radius;
     near.isHeap = false;
     nearestNSearch(root, &near);
+
+    RAY_STATS_ADD(PHOTON_LOOKUPS, 1);
+    RAY_STATS_ADD(PHOTONS_GATHERED, results.size());
 }
 
 void PhotonMap::nearestNSearch(KDnode* node, NearestN* near)
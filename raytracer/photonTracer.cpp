@@ -1,5 +1,6 @@
 #include "photonTracer.h"
 #include "raytracer.h"
+#include "random.h"
 
 PhotonTracer::PhotonTracer(Raytracer* r, PhotonMap& p, int b) :
     raytracer(r), photonMap(p), maxBounces(b)
@@ -62,7 +63,7 @@ PhotonTracer::Action PhotonTracer::determineAction(Ray& ray)
     float reflect = s->getMaterial().getReflective();
     float refract = s->getMaterial().getRefraction();
 
-    float randomVal = (float)(rand() % 1025) / 1024.0f;
+    float randomVal = Random::local().nextFloat();
 
     if(randomVal <= diffuse)
         return DIFFUSE;
@@ -148,7 +149,7 @@ Vector3 PhotonTracer::refractDirection(Vector3& dir, Vector3& normal, float IOR)
 
     float reflectComp = 0.5f * (parallel * parallel + perp * perp);
 
-    float randomVal = (float)(rand() % 1025) / 1024.0f;
+    float randomVal = Random::local().nextFloat();
     if(randomVal <= reflectComp){
         if(incidentDot < 0.0f)
             return reflectDirection(dir, normal);
@@ -47,11 +47,15 @@ Plane::Plane(Vector3 c, Vector3 r, Vector3 u)
     rightBound = -1.0f;
 }
 
-bool Plane::Intersection(Ray& r, Hitpoint& h)
+bool Plane::Intersection(Ray& r, Hitpoint& h, float tMin, float tMax)
 {
     //compute the intersection time
     float newT = -(Vector3::DotProduct(r.origin, normal) + d) / Vector3::DotProduct(r.dir, normal);
 
+    //outside the interval, this also rejects rays lying in the plane
+    if(!(newT > tMin && newT < tMax))
+        return false;
+
     //if the value is not infinte
     if(!isinf(newT)){
         //intersection point
@@ -85,6 +89,28 @@ Vector3 Plane::getNormal(Ray& ray)
     return normal;
 }
 
+//infinite planes have no bounds
+bool Plane::getBounds(Vector3& minBound, Vector3& maxBound)
+{
+    if(rightBound < 0 && upBound < 0)
+        return false;
+
+    minBound = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+    maxBound = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(int i = 0; i < 4; i++){
+        Vector3 corner = center + ((i & 1) ? rightBound : -rightBound) * right + ((i & 2) ? upBound : -upBound) * up;
+        for(int k = 0; k < 3; k++){
+            minBound.elements[k] = min(minBound.elements[k], corner.elements[k]);
+            maxBound.elements[k] = max(maxBound.elements[k], corner.elements[k]);
+        }
+    }
+
+    //give the flat box some thickness
+    minBound -= Vector3(Ray::SMALL, Ray::SMALL, Ray::SMALL);
+    maxBound += Vector3(Ray::SMALL, Ray::SMALL, Ray::SMALL);
+    return true;
+}
+
 void Plane::getUV(Vector3& point, Ray& ray, float& u, float& v)
 {
     u = Vector3::DotProduct(point, right);
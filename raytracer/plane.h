@@ -18,8 +18,9 @@ class Plane : public Shape
 
     private:
 
-        bool Intersection(Ray&, Hitpoint&);
+        bool Intersection(Ray&, Hitpoint&, float, float);
         Vector3 getNormal(Ray&);
+        bool getBounds(Vector3&, Vector3&);
 
         Vector3 center;
         Vector3 up;
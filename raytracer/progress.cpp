@@ -1,21 +1,12 @@
 #include "progress.h"
-#include "manager.h"
 
-Progress::Progress(int threads, int blockSetup, Block* blocks)
+Progress::Progress(int width, int height)
 {
     linesComplete = 0;
-    if(blockSetup == 1)
-        linesTotal = blocks[0].height;
-    else{
-        linesTotal = 0;
-        for(int i = 0; i < blockSetup * blockSetup; i++){
-            if(i % blockSetup == 0)
-                linesTotal += blocks[i].height;
-        }
-    }
+    linesTotal = height;
 
-    blocksComplete = 0;
-    blocksTotal = blockSetup * blockSetup;
+    pixelsDone = 0;
+    pixelsTotal = width * height;
 
     handler = NULL;
 }
@@ -32,11 +23,11 @@ void Progress::lineComplete(void)
         handler->lineComplete(linesComplete, linesTotal);
 }
 
-void Progress::blockComplete(void)
+void Progress::pixelsComplete(int pixels)
 {
     completeMutex.lock();
-    blocksComplete++;
+    pixelsDone += pixels;
     if(handler)
-        handler->blockComplete(blocksComplete, blocksTotal);
+        handler->blockComplete(pixelsDone, pixelsTotal);
     completeMutex.unlock();
 }
@@ -5,18 +5,16 @@
 #include <mutex>
 #include "progressEvent.h"
 
-struct Block;
-
 class Progress
 {
     public:
 
-        Progress(int, int, Block*);
+        Progress(int, int);
 
         void setEventHandler(ProgressEvent*);
 
         void lineComplete(void);
-        void blockComplete(void);
+        void pixelsComplete(int);
 
     private:
 
@@ -25,8 +23,10 @@ class Progress
         int linesComplete;
         int linesTotal;
 
-        int blocksComplete;
-        int blocksTotal;
+        //tiles are split while rendering, so the threaded
+        //progress is counted in pixels instead of blocks
+        int pixelsDone;
+        int pixelsTotal;
 
         std::mutex completeMutex;
 };
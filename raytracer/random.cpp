@@ -0,0 +1,43 @@
+#include "random.h"
+
+Random::Random(void)
+{
+    seed(0, 0);
+}
+
+Random::Random(uint64_t initState, uint64_t stream)
+{
+    seed(initState, stream);
+}
+
+//the stream selects one of 2^63 independent sequences
+void Random::seed(uint64_t initState, uint64_t stream)
+{
+    state = 0;
+    increment = (stream << 1) | 1;
+    nextUInt();
+    state += initState;
+    nextUInt();
+}
+
+uint32_t Random::nextUInt(void)
+{
+    uint64_t old = state;
+    state = old * 6364136223846793005ULL + increment;
+    uint32_t shifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (shifted >> rot) | (shifted << ((-rot) & 31));
+}
+
+//uniform in [0, 1), the top 24 bits fill the float mantissa exactly
+float Random::nextFloat(void)
+{
+    return (float)(nextUInt() >> 8) * (1.0f / 16777216.0f);
+}
+
+//the context of the calling thread
+Random& Random::local(void)
+{
+    static thread_local Random context;
+    return context;
+}
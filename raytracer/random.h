@@ -0,0 +1,28 @@
+#ifndef RANDOM_H_INCLUDED
+#define RANDOM_H_INCLUDED
+
+#include <stdint.h>
+
+//PCG32 generator, every render thread owns one context that is
+//reseeded per tile so images do not depend on the thread schedule
+class Random
+{
+    public:
+
+        Random(void);
+        Random(uint64_t, uint64_t);
+
+        void seed(uint64_t, uint64_t);
+
+        uint32_t nextUInt(void);
+        float nextFloat(void);
+
+        static Random& local(void);
+
+    private:
+
+        uint64_t state;
+        uint64_t increment;
+};
+
+#endif // RANDOM_H_INCLUDED
@@ -30,6 +30,7 @@ class Ray
         Shape* cacheShape;
         float cacheFloat1;
         float cacheFloat2;
+        int cacheIndex;
 };
 
 #endif // RAY_H_INCLUDED
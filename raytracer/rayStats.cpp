@@ -0,0 +1,136 @@
+#include "rayStats.h"
+#include "log.h"
+#include "shape.h"
+
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <typeinfo>
+
+#ifdef __GNUC__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+RayStats::RayStats(void)
+{
+    reset();
+}
+
+void RayStats::reset(void)
+{
+    for(int i = 0; i < NUM_COUNTERS; i++)
+        counts[i] = 0;
+    objects.clear();
+}
+
+void RayStats::merge(const RayStats& other)
+{
+    for(int i = 0; i < NUM_COUNTERS; i++)
+        counts[i] += other.counts[i];
+
+    std::unordered_map<Shape*, ObjectCost>::const_iterator it;
+    for(it = other.objects.begin(); it != other.objects.end(); it++){
+        ObjectCost& cost = objects[it->first];
+        cost.tests += it->second.tests;
+        cost.hits += it->second.hits;
+        cost.time += it->second.time;
+    }
+}
+
+void RayStats::addObject(Shape* object, int tests, int hits, double time)
+{
+    ObjectCost& cost = objects[object];
+    cost.tests += tests;
+    cost.hits += hits;
+    cost.time += time;
+}
+
+//three decimals, the per pixel rates are often below one
+static std::string rate(double count, double total)
+{
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(3) << (total > 0 ? (double)count / total : 0.0);
+    return s.str();
+}
+
+//writes the per pixel and per ray rates to the log
+void RayStats::report(int pixels)
+{
+    long long rays = getRays();
+
+    Log::writeLine("Rays per pixel: " + rate(rays, pixels) +
+                   " (primary " + rate(counts[PRIMARY], pixels) +
+                   ", reflection " + rate(counts[REFLECTION], pixels) +
+                   ", refraction " + rate(counts[REFRACTION], pixels) +
+                   ", glossy " + rate(counts[GLOSSY], pixels) +
+                   ", shadow " + rate(counts[SHADOW], pixels) + ")");
+    Log::writeLine("Tests per ray: " + rate(counts[OBJECT_TESTS], rays) + " objects, " +
+                   rate(counts[TRIANGLE_TESTS], rays) + " triangles");
+    if(counts[PHOTON_LOOKUPS] > 0)
+        Log::writeLine("Photon lookups: " + rate(counts[PHOTON_LOOKUPS], pixels) + " per pixel, " +
+                       rate(counts[PHOTONS_GATHERED], counts[PHOTON_LOOKUPS]) + " photons gathered on average");
+}
+
+//the class of the shape without the compiler's decoration
+static std::string shapeType(Shape* shape)
+{
+    const char* name = typeid(*shape).name();
+#ifdef __GNUC__
+    int status;
+    char* demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+    if(status == 0){
+        std::string result = demangled;
+        free(demangled);
+        return result;
+    }
+#endif
+    return name;
+}
+
+static bool byTime(const std::pair<Shape*, RayStats::ObjectCost>& a, const std::pair<Shape*, RayStats::ObjectCost>& b)
+{
+    return a.second.time > b.second.time;
+}
+
+//logs the objects that took the most intersection time, objects are
+//numbered in the order the scene file declares them
+void RayStats::reportObjects(std::vector<Shape*>& sceneObjects, int count)
+{
+    std::vector<std::pair<Shape*, ObjectCost> > sorted(objects.begin(), objects.end());
+    sort(sorted.begin(), sorted.end(), byTime);
+
+    double total = 0.0;
+    for(int i = 0; i < sorted.size(); i++)
+        total += sorted[i].second.time;
+
+    Log::writeLine("Most expensive objects (" + rate(total * 1000.0, 1) + " ms of intersection time):");
+    for(int i = 0; i < min(count, (int)sorted.size()); i++){
+        Shape* shape = sorted[i].first;
+        ObjectCost& cost = sorted[i].second;
+        int index = find(sceneObjects.begin(), sceneObjects.end(), shape) - sceneObjects.begin();
+
+        Log::writeLine("  #" + Log::intToString(index) + " " + shapeType(shape) +
+                       (shape->transformed() ? " (transformed)" : "") + ": " +
+                       std::to_string(cost.tests) + " tests, " +
+                       rate(cost.hits * 100, cost.tests) + "% hit, " +
+                       rate(cost.time * 1000.0, 1) + " ms, " +
+                       rate(cost.time * 1e9, cost.tests) + " ns per test");
+    }
+}
+
+//rays of every kind traced so far
+long long RayStats::getRays(void)
+{
+    long long rays = 0;
+    for(int i = PRIMARY; i <= SHADOW; i++)
+        rays += counts[i];
+    return rays;
+}
+
+//the counters of the calling thread
+RayStats& RayStats::local(void)
+{
+    static thread_local RayStats stats;
+    return stats;
+}
@@ -0,0 +1,56 @@
+#ifndef RAYSTATS_H_INCLUDED
+#define RAYSTATS_H_INCLUDED
+
+#include <vector>
+#include <unordered_map>
+
+//uncomment or pass -DRAY_STATS to count rays and intersection tests,
+//without it the counting macros compile to nothing
+//#define RAY_STATS
+
+class Shape;
+
+//counters of the calling thread, every render thread counts into its
+//own copy and the manager merges them once the image is done
+class RayStats
+{
+    public:
+
+        enum Counter {PRIMARY, REFLECTION, REFRACTION, GLOSSY, SHADOW,
+                      OBJECT_TESTS, TRIANGLE_TESTS, PHOTON_LOOKUPS, PHOTONS_GATHERED,
+                      NUM_COUNTERS};
+
+        //rays that tested an object, how many of them hit it and
+        //the seconds spent in Shape::intersectRay including the transform
+        struct ObjectCost
+        {
+            long long tests;
+            long long hits;
+            double time;
+
+            ObjectCost(void) : tests(0), hits(0), time(0.0){}
+        };
+
+        RayStats(void);
+
+        void reset(void);
+        void merge(const RayStats&);
+        void report(int);
+        void reportObjects(std::vector<Shape*>&, int);
+
+        void addObject(Shape*, int, int, double);
+        long long getRays(void);
+
+        long long counts[NUM_COUNTERS];
+        std::unordered_map<Shape*, ObjectCost> objects;
+
+        static RayStats& local(void);
+};
+
+#ifdef RAY_STATS
+    #define RAY_STATS_ADD(counter, n) (RayStats::local().counts[RayStats::counter] += (n))
+#else
+    #define RAY_STATS_ADD(counter, n) ((void)0)
+#endif
+
+#endif // RAYSTATS_H_INCLUDED
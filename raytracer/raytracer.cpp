@@ -1,5 +1,10 @@
 #include "raytracer.h"
 #include "parser.h"
+#include "packet.h"
+#include "random.h"
+#include "timer.h"
+#include "rayStats.h"
+#include "trace.h"
 
 Raytracer::Raytracer(void)
 {
@@ -18,14 +23,25 @@ Raytracer::Raytracer(void)
 
     config.gamma = 1.0f;
 
+    config.packetSize = 8;
+
+    config.lightSamples = 0;
+    config.shadowThreshold = 0.0f;
+    config.adaptiveShadows = false;
+    config.shadowMapSize = 0;
+    config.stochasticFresnel = false;
+
+    config.seed = 0;
+
     config.sampler = NULL;
 
     parser = new Parser(this);
 
     photonMap = NULL;
 
-    //srand(time(NULL));
-    srand(0);
+    sceneTree = new BVH(2);
+
+    lightTree = NULL;
 }
 
 Raytracer::~Raytracer(void)
@@ -40,20 +56,41 @@ Raytracer::~Raytracer(void)
        delete config.camera;
     delete config.sampler;
     delete parser;
+    delete sceneTree;
+    delete lightTree;
 }
 
 bool Raytracer::loadScene(string fileName)
 {
-    //load the scene into the tracer
-    bool result = parser->loadScene(fileName, config);
+    setupTimes.parse = 0.0f;
+    setupTimes.build = 0.0f;
+    setupTimes.photon = 0.0f;
+    Timer timer;
+
+    //load the scene into the tracer, meshes add their build time
+    bool result;
+    {
+        TraceScope scope("parse scene", fileName);
+        result = parser->loadScene(fileName, config);
+    }
+    setupTimes.parse = timer.elapsed() - setupTimes.build;
 
     if(config.sampler == NULL)
         config.sampler = new simpleSampler(this, config);
     if(config.camera == NULL)
         config.camera = new Camera(Vector3(0, 0, 0), Vector3(0, 0, 1), Vector3(0, 1, 0), config.width, config.height);
 
-    if(config.mode == Config::PHOTON)
+    timer.restart();
+    setupSceneTree();
+    setupLightTree();
+    setupShadowMaps();
+    setupTimes.build += timer.elapsed();
+
+    if(config.mode == Config::PHOTON){
+        timer.restart();
         setupPhotonMap();
+        setupTimes.photon = timer.elapsed();
+    }
 
     return result;
 }
@@ -67,13 +104,94 @@ void Raytracer::setupPhotonMap(void)
         totalPower += lights[i]->getIntensity();
 
     for(int i = 0; i < lights.size(); i++){
+        TraceScope scope("emit photons", "light " + Log::intToString(i));
         int numPhotons = (lights[i]->getIntensity() / totalPower) * config.photonCount;
+        seedRandom(config.width * config.height + i);
         lights[i]->emitPhotons(*photonMap, numPhotons, config.photonBounces);
     }
 
     photonMap->setup();
 }
 
+//builds the scene level BVH over the bounded objects
+void Raytracer::setupSceneTree(void)
+{
+    TraceScope scope("scene BVH");
+    vector<BVHPrimitive> primitives;
+    unbounded.clear();
+    for(int i = 0; i < objects.size(); i++){
+        Vector3 minBound, maxBound;
+        if(objects[i]->computeBounds(minBound, maxBound))
+            primitives.push_back(BVHPrimitive(minBound, maxBound, i));
+        else
+            unbounded.push_back(objects[i]);
+    }
+
+    sceneTree->createTree(primitives);
+
+    Log::writeLine("Scene BVH: " + Log::intToString(sceneTree->getNodeCount()) + " nodes, " +
+                   Log::intToString(sceneTree->getMemoryUsage() / 1024) + " KB, " +
+                   Log::intToString(primitives.size()) + " objects, " +
+                   Log::intToString(unbounded.size()) + " unbounded");
+}
+
+//builds the light tree when the scene samples its lights, with no
+//more lights than samples every light is evaluated as usual
+void Raytracer::setupLightTree(void)
+{
+    if(config.lightSamples == 0)
+        return;
+
+    TraceScope scope("light tree");
+    vector<Light*> bounded;
+    vector<LightBounds> bounds;
+    unboundedLights.clear();
+    for(int i = 0; i < lights.size(); i++){
+        LightBounds b;
+        if(lights[i]->computeBounds(b)){
+            bounded.push_back(lights[i]);
+            bounds.push_back(b);
+        }
+        else
+            unboundedLights.push_back(lights[i]);
+    }
+
+    if(bounded.size() <= config.lightSamples){
+        unboundedLights.clear();
+        return;
+    }
+
+    lightTree = new LightTree();
+    lightTree->createTree(bounded, bounds);
+
+    Log::writeLine("Light tree: " + Log::intToString(lightTree->getNodeCount()) + " nodes, " +
+                   Log::intToString(bounded.size()) + " lights, " +
+                   Log::intToString(unboundedLights.size()) + " unbounded, " +
+                   Log::intToString(config.lightSamples) + " samples per hit");
+}
+
+//casts the shadow maps of the directional lights over the bounded objects
+void Raytracer::setupShadowMaps(void)
+{
+    if(config.shadowMapSize == 0 || sceneTree->getNodeCount() == 0)
+        return;
+
+    TraceScope scope("shadow maps");
+    Vector3 minBound, maxBound;
+    sceneTree->getBounds(minBound, maxBound);
+
+    int maps = 0;
+    for(int i = 0; i < lights.size(); i++){
+        if(lights[i]->createShadowMap(config.shadowMapSize, minBound, maxBound))
+            maps++;
+    }
+
+    if(maps > 0)
+        Log::writeLine("Shadow maps: " + Log::intToString(maps) + " of " +
+                       Log::intToString(config.shadowMapSize) + "x" + Log::intToString(config.shadowMapSize) + ", " +
+                       Log::intToString(maps * config.shadowMapSize * config.shadowMapSize * sizeof(float) / 1024) + " KB");
+}
+
 //return the image width
 int Raytracer::getWidth(void)
 {
@@ -86,6 +204,45 @@ int Raytracer::getHeight(void)
     return config.height;
 }
 
+//return the tile size used for packet tracing
+int Raytracer::getPacketSize(void)
+{
+    return config.packetSize;
+}
+
+float Raytracer::getShadowThreshold(void)
+{
+    return config.shadowThreshold;
+}
+
+bool Raytracer::getAdaptiveShadows(void)
+{
+    return config.adaptiveShadows;
+}
+
+//overrides the packet size of the scene, must be set before rendering
+void Raytracer::setPacketSize(int size)
+{
+    config.packetSize = max(1, min(size, 8));
+}
+
+//a copy of the scene's sampler for one render thread,
+//the caller owns it
+Sampler* Raytracer::createSampler(void)
+{
+    return config.sampler->clone();
+}
+
+SetupTimes& Raytracer::getSetupTimes(void)
+{
+    return setupTimes;
+}
+
+vector<Shape*>& Raytracer::getObjects(void)
+{
+    return objects;
+}
+
 void Raytracer::addObject(Shape* newObject)
 {
     objects.push_back(newObject);
@@ -94,17 +251,55 @@ void Raytracer::addObject(Shape* newObject)
 void Raytracer::addLight(Light* newLight)
 {
     lights.push_back(newLight);
+    if(newLight->getSurface() != NULL)
+        surfaceLights.push_back(newLight);
 }
 
 Vector3 Raytracer::tracePixel(int x, int y)
 {
+    seedRandom(y * config.width + x);
     Vector3 result = config.sampler->samplePixel(x, y);
     gammaCorrection(result);
     return result;
 }
 
+//traces a tile of at most packetSize by packetSize pixels with the
+//calling thread's sampler, the colors are stored row by row
+void Raytracer::traceTile(int x, int y, int width, int height, Vector3* colors, Sampler* sampler)
+{
+    //tiles always start at the same pixels, so seeding from the first
+    //one gives the same image for any number of threads
+    seedRandom(y * config.width + x);
+
+    if(width * height == 1 || !sampler->samplePacket(x, y, width, height, colors)){
+        for(int i = 0; i < height; i++){
+            for(int j = 0; j < width; j++)
+                colors[i * width + j] = sampler->samplePixel(x + j, y + i);
+        }
+    }
+
+    for(int i = 0; i < width * height; i++)
+        gammaCorrection(colors[i]);
+}
+
+//primary visibility is found for the whole packet at once,
+//everything after the first hit is traced ray by ray
+void Raytracer::tracePacket(RayPacket& packet, Vector3* colors)
+{
+    RAY_STATS_ADD(PRIMARY, packet.size);
+    intersectPacket(packet);
+
+    for(int i = 0; i < packet.size; i++){
+        if(packet.rays[i].s)
+            colors[i] = computeColor(packet.rays[i], 0, 1.0f);
+        else
+            colors[i] = config.backColor;
+    }
+}
+
 Vector3 Raytracer::traceRay(Ray& ray)
 {
+    RAY_STATS_ADD(PRIMARY, 1);
     intersectRay(ray);
 
     //if(ray.s){
@@ -118,6 +313,13 @@ Vector3 Raytracer::traceRay(Ray& ray)
     return config.backColor;
 }
 
+//starts the calling thread's random sequence, every stream
+//is independent of the others for the same scene seed
+void Raytracer::seedRandom(int stream)
+{
+    Random::local().seed(config.seed, stream);
+}
+
 void Raytracer::gammaCorrection(Vector3& color)
 {
     for(int i = 0; i < 3; i++)
@@ -127,32 +329,76 @@ void Raytracer::gammaCorrection(Vector3& color)
 //test the ray against all objects
 bool Raytracer::intersectRay(Ray& ray)
 {
-    float minT = DBL_MAX;
+    Hitpoint closest;
+    closest.t = DBL_MAX;
     Shape* minS = NULL;
-    Vector3 point;
-    Hitpoint hit;
-    float f1;
-    float f2;
-    Shape* s;
-    for(int k = 0; k < objects.size(); k++){
-        if(objects.at(k)->intersectRay(ray, hit)){
-            if(hit.t > Ray::SMALL && hit.t < minT){
-                minT = hit.t;
-                minS = objects.at(k);
-                point = hit.point;
-                f1 = hit.f1;
-                f2 = hit.f2;
-                s = hit.s;
+
+    //unbounded objects are not part of the tree
+    RAY_STATS_ADD(OBJECT_TESTS, unbounded.size());
+    for(int k = 0; k < unbounded.size(); k++)
+        intersectObject(unbounded[k], ray, closest, minS);
+
+    BVHNode* nodes = sceneTree->getNodes();
+    int* indices = sceneTree->getIndices();
+
+    Vector3 invDir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+
+    //walk the tree front to back, skipping nodes beyond the closest hit
+    int stack[BVH::maxStack];
+    float stackT[BVH::maxStack];
+    int top = 0;
+    float tNear;
+    if(sceneTree->getNodeCount() > 0 && sceneTree->intersectNode(0, ray.origin, invDir, closest.t, tNear)){
+        stack[top] = 0;
+        stackT[top] = tNear;
+        top++;
+    }
+
+    while(top > 0){
+        top--;
+        if(stackT[top] > closest.t)
+            continue;
+        BVHNode& node = nodes[stack[top]];
+
+        if(node.count > 0){
+            RAY_STATS_ADD(OBJECT_TESTS, node.count);
+            for(int k = 0; k < node.count; k++)
+                intersectObject(objects[indices[node.offset + k]], ray, closest, minS);
+            continue;
+        }
+
+        int left = stack[top] + 1;
+        int right = node.offset;
+        float tLeft, tRight;
+        bool hitLeft = sceneTree->intersectNode(left, ray.origin, invDir, closest.t, tLeft);
+        bool hitRight = sceneTree->intersectNode(right, ray.origin, invDir, closest.t, tRight);
+
+        //push the far child first so the near child is visited next
+        if(hitLeft && hitRight && tRight < tLeft){
+            stack[top] = left;
+            stackT[top++] = tLeft;
+            stack[top] = right;
+            stackT[top++] = tRight;
+        }
+        else{
+            if(hitRight){
+                stack[top] = right;
+                stackT[top++] = tRight;
+            }
+            if(hitLeft){
+                stack[top] = left;
+                stackT[top++] = tLeft;
             }
         }
     }
 
-    ray.t = minT;
+    ray.t = closest.t;
     ray.s = minS;
-    ray.point = point;
-    ray.cacheFloat1 = f1;
-    ray.cacheFloat2 = f2;
-    ray.cacheShape = s;
+    ray.point = closest.point;
+    ray.cacheFloat1 = closest.f1;
+    ray.cacheFloat2 = closest.f2;
+    ray.cacheShape = closest.s;
+    ray.cacheIndex = closest.index;
 
     if(!minS)
         return false;
@@ -160,25 +406,276 @@ bool Raytracer::intersectRay(Ray& ray)
     return true;
 }
 
-float Raytracer::computeShadowFactor(Ray& ray, float range)
+//the packet version of intersectRay, each ray ends up with the same
+//hit information intersectRay would give it
+void Raytracer::intersectPacket(RayPacket& packet)
 {
-    float minT = DBL_MAX;
+    for(int i = 0; i < packet.size; i++){
+        packet.active[i] = true;
+        packet.hits[i].t = DBL_MAX;
+        packet.shapes[i] = NULL;
+    }
+    packet.setup();
+
+    //rays pointing in different directions get nothing from the frustum
+    if(!packet.coherent){
+        for(int i = 0; i < packet.size; i++)
+            intersectRay(packet.rays[i]);
+        return;
+    }
+
+    RAY_STATS_ADD(OBJECT_TESTS, unbounded.size() * packet.size);
+    for(int k = 0; k < unbounded.size(); k++)
+        testPacket(unbounded[k], packet, packet.size);
+
+    BVHNode* nodes = sceneTree->getNodes();
+    int* indices = sceneTree->getIndices();
+
+    int stack[BVH::maxStack];
+    float stackT[BVH::maxStack];
+    int top = 0;
+    float tNear;
+    if(sceneTree->getNodeCount() > 0 && packet.intersectBox(nodes[0].Min, nodes[0].Max, packet.getMaxT(), tNear)){
+        stack[top] = 0;
+        stackT[top++] = tNear;
+    }
+
+    while(top > 0){
+        top--;
+        if(stackT[top] > packet.getMaxT())
+            continue;
+        int index = stack[top];
+        BVHNode& node = nodes[index];
+
+        if(node.count > 0){
+            //only the rays that really enter the leaf test its objects
+            int entered = 0;
+            for(int i = 0; i < packet.size; i++){
+                packet.active[i] = sceneTree->intersectNode(index, packet.rays[i].origin, packet.invDir[i], packet.hits[i].t, tNear);
+                entered += packet.active[i];
+            }
+            bool any = entered > 0;
+            RAY_STATS_ADD(OBJECT_TESTS, entered * node.count);
+            if(any){
+                for(int k = 0; k < node.count; k++)
+                    testPacket(objects[indices[node.offset + k]], packet, entered);
+            }
+            for(int i = 0; i < packet.size; i++)
+                packet.active[i] = true;
+            continue;
+        }
+
+        int left = index + 1;
+        int right = node.offset;
+        float maxT = packet.getMaxT();
+        float tLeft, tRight;
+        bool hitLeft = packet.intersectBox(nodes[left].Min, nodes[left].Max, maxT, tLeft);
+        bool hitRight = packet.intersectBox(nodes[right].Min, nodes[right].Max, maxT, tRight);
+
+        if(hitLeft && hitRight && tRight < tLeft){
+            stack[top] = left;
+            stackT[top++] = tLeft;
+            stack[top] = right;
+            stackT[top++] = tRight;
+        }
+        else{
+            if(hitRight){
+                stack[top] = right;
+                stackT[top++] = tRight;
+            }
+            if(hitLeft){
+                stack[top] = left;
+                stackT[top++] = tLeft;
+            }
+        }
+    }
+
+    for(int i = 0; i < packet.size; i++){
+        Ray& ray = packet.rays[i];
+        Hitpoint& closest = packet.hits[i];
+        ray.t = closest.t;
+        ray.s = packet.shapes[i];
+        ray.point = closest.point;
+        ray.cacheFloat1 = closest.f1;
+        ray.cacheFloat2 = closest.f2;
+        ray.cacheShape = closest.s;
+        ray.cacheIndex = closest.index;
+    }
+}
+
+void Raytracer::intersectObject(Shape* object, Ray& ray, Hitpoint& closest, Shape*& minS)
+{
+    //only hits nearer than the closest so far are computed in full
     Hitpoint hit;
-    float factor = 1.0f;
-    for(int k = 0; k < objects.size(); k++){
-        if(objects.at(k)->getMaterial().isEmissive())
+    if(testObject(object, ray, hit, closest.t)){
+        closest.t = hit.t;
+        closest.point = hit.point;
+        closest.f1 = hit.f1;
+        closest.f2 = hit.f2;
+        closest.s = hit.s;
+        closest.index = hit.index;
+        minS = object;
+    }
+}
+
+//shadow rays only ask whether anything lies between the point and
+//the light, every test stops at the first occluder within range
+float Raytracer::computeShadowFactor(Ray& ray, float range)
+{
+    RAY_STATS_ADD(SHADOW, 1);
+
+    for(int k = 0; k < unbounded.size(); k++){
+        if(occludesRay(unbounded[k], ray, range))
+            return 0.0f;
+    }
+
+    BVHNode* nodes = sceneTree->getNodes();
+    int* indices = sceneTree->getIndices();
+
+    Vector3 invDir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+
+    //any occluder will do, so the traversal order does not matter
+    int stack[BVH::maxStack];
+    int top = 0;
+    float tNear;
+    if(sceneTree->getNodeCount() > 0 && sceneTree->intersectNode(0, ray.origin, invDir, range, tNear))
+        stack[top++] = 0;
+
+    while(top > 0){
+        int current = stack[--top];
+        BVHNode& node = nodes[current];
+
+        if(node.count > 0){
+            for(int k = 0; k < node.count; k++){
+                if(occludesRay(objects[indices[node.offset + k]], ray, range))
+                    return 0.0f;
+            }
+            continue;
+        }
+
+        if(sceneTree->intersectNode(node.offset, ray.origin, invDir, range, tNear))
+            stack[top++] = node.offset;
+        if(sceneTree->intersectNode(current + 1, ray.origin, invDir, range, tNear))
+            stack[top++] = current + 1;
+    }
+
+    return 1.0f;
+}
+
+//distance to the closest surface that casts shadows, FLT_MAX when the
+//ray leaves the scene, the same objects as computeShadowFactor are
+//skipped and nothing is counted in the ray stats since it only builds
+//the shadow maps
+float Raytracer::occluderDistance(Ray& ray)
+{
+    float closest = FLT_MAX;
+    auto test = [&](Shape* object){
+        Hitpoint hit;
+        if(!object->getMaterial().isEmissive() && object->intersectRay(ray, hit, Ray::SMALL, closest))
+            closest = hit.t;
+    };
+
+    for(int k = 0; k < unbounded.size(); k++)
+        test(unbounded[k]);
+
+    BVHNode* nodes = sceneTree->getNodes();
+    int* indices = sceneTree->getIndices();
+
+    Vector3 invDir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+
+    //front to back like intersectRay
+    int stack[BVH::maxStack];
+    float stackT[BVH::maxStack];
+    int top = 0;
+    float tNear;
+    if(sceneTree->getNodeCount() > 0 && sceneTree->intersectNode(0, ray.origin, invDir, closest, tNear)){
+        stack[top] = 0;
+        stackT[top] = tNear;
+        top++;
+    }
+
+    while(top > 0){
+        top--;
+        if(stackT[top] > closest)
+            continue;
+        BVHNode& node = nodes[stack[top]];
+
+        if(node.count > 0){
+            for(int k = 0; k < node.count; k++)
+                test(objects[indices[node.offset + k]]);
             continue;
-        if(objects.at(k)->intersectRay(ray, hit)){
-            if(hit.t > Ray::SMALL && hit.t <= range && hit.t < minT){
-                minT = hit.t;
-                factor = 0.0f;
-                break;
+        }
+
+        int left = stack[top] + 1;
+        int right = node.offset;
+        float tLeft, tRight;
+        bool hitLeft = sceneTree->intersectNode(left, ray.origin, invDir, closest, tLeft);
+        bool hitRight = sceneTree->intersectNode(right, ray.origin, invDir, closest, tRight);
+
+        if(hitLeft && hitRight && tRight < tLeft){
+            stack[top] = left;
+            stackT[top++] = tLeft;
+            stack[top] = right;
+            stackT[top++] = tRight;
+        }
+        else{
+            if(hitRight){
+                stack[top] = right;
+                stackT[top++] = tRight;
+            }
+            if(hitLeft){
+                stack[top] = left;
+                stackT[top++] = tLeft;
             }
         }
     }
 
-    ray.t = minT;
-    return factor;
+    return closest;
+}
+
+bool Raytracer::occludesRay(Shape* object, Ray& ray, float range)
+{
+    if(object->getMaterial().isEmissive())
+        return false;
+    RAY_STATS_ADD(OBJECT_TESTS, 1);
+#ifdef RAY_STATS
+    Timer timer;
+    bool found = object->occludesRay(ray, range);
+    RayStats::local().addObject(object, 1, found, timer.elapsed());
+    return found;
+#else
+    return object->occludesRay(ray, range);
+#endif // RAY_STATS
+}
+
+//Shape::intersectRay, timed per object when built with RAY_STATS
+bool Raytracer::testObject(Shape* object, Ray& ray, Hitpoint& hit, float tMax)
+{
+#ifdef RAY_STATS
+    Timer timer;
+    bool found = object->intersectRay(ray, hit, Ray::SMALL, tMax);
+    RayStats::local().addObject(object, 1, found, timer.elapsed());
+    return found;
+#else
+    return object->intersectRay(ray, hit, Ray::SMALL, tMax);
+#endif // RAY_STATS
+}
+
+//Shape::intersectPacket, the rays that entered count as tests and
+//the rays the object became the closest hit of count as hits
+void Raytracer::testPacket(Shape* object, RayPacket& packet, int tests)
+{
+#ifdef RAY_STATS
+    Timer timer;
+    object->intersectPacket(packet);
+    int hits = 0;
+    for(int i = 0; i < packet.size; i++)
+        hits += packet.shapes[i] == object;
+    RayStats::local().addObject(object, tests, hits, timer.elapsed());
+#else
+    (void)tests;
+    object->intersectPacket(packet);
+#endif // RAY_STATS
 }
 
 //determine the color based on the intersection point
@@ -188,39 +685,67 @@ Vector3 Raytracer::computeColor(Ray& ray, int depth, float factor)
     if(depth > config.reflectionDepth)
         return Vector3(0, 0, 0);
 
-    //contrabution to recursion is too small
-    if(factor < config.recursionThreshold)
-        return Vector3(0, 0, 0);
+    //contrabution to recursion is too small, the stochastic mode plays
+    //russian roulette instead and makes up for the paths it ends
+    float survival = 1.0f;
+    if(factor < config.recursionThreshold){
+        if(!config.stochasticFresnel)
+            return Vector3(0, 0, 0);
+        survival = factor / config.recursionThreshold;
+        if(Random::local().nextFloat() >= survival)
+            return Vector3(0, 0, 0);
+        factor = config.recursionThreshold;
+    }
 
     if(ray.s->getMaterial().isEmissive())
-        return ray.s->getMaterial().getEmissiveColor();
+        return ray.s->getMaterial().getEmissiveColor() * (1.0f / survival);
 
     //normal at point
     Vector3 n = ray.s->computeNormal(ray);
 
+    //the stochastic mode follows either the reflection or the refraction,
+    //picked by their weights and divided by the chance of the pick
+    bool reflect = ray.s->getMaterial().getReflective() > 0.0f;
+    bool refract = ray.s->getMaterial().getRefraction() > 0.0f;
+    float reflectWeight = 1.0f;
+    float refractWeight = 1.0f;
+    if(config.stochasticFresnel && reflect && refract){
+        Vector3 filter = ray.s->getMaterial().getReflectColor();
+        float reflectShare = ray.s->getMaterial().getReflective() * max(max(filter.x, filter.y), filter.z);
+        float chance = reflectShare / (reflectShare + ray.s->getMaterial().getRefraction());
+        if(Random::local().nextFloat() < chance){
+            refract = false;
+            reflectWeight = 1.0f / chance;
+        }
+        else{
+            reflect = false;
+            refractWeight = 1.0f / (1.0f - chance);
+        }
+    }
+
     //reflection amount
     Vector3 reflection(0, 0, 0);
-    if(ray.s->getMaterial().getReflective() > 0.0f){
-        if(ray.s->getMaterial().getGlossiness() > 0.0f && depth == 0)
-            reflection = calculateGlossyReflection(ray, n, depth, factor);
+    if(reflect){
+        if(ray.s->getMaterial().getGlossiness() > 0.0f)
+            reflection = calculateGlossyReflection(ray, n, depth, factor * reflectWeight);
         else
-            reflection = calculateReflection(ray, n, depth, factor);
+            reflection = calculateReflection(ray, n, depth, factor * reflectWeight);
     }
 
     //refraction amount
     Vector3 refraction(0, 0, 0);
-    if(ray.s->getMaterial().getRefraction() > 0.0f){
-        if(ray.s->getMaterial().getGlossiness() > 0.0f && depth == 0)
-            refraction = calculateGlossyRefraction(ray, n, depth, factor);
+    if(refract){
+        if(ray.s->getMaterial().getGlossiness() > 0.0f)
+            refraction = calculateGlossyRefraction(ray, n, depth, factor * refractWeight);
         else
-            refraction = calculateRefraction(ray, n, depth, factor);
+            refraction = calculateRefraction(ray, n, depth, factor * refractWeight);
     }
 
     //final color
-    Vector3 color = calculateLightStandard(ray, n) + reflection + refraction;
+    Vector3 color = calculateLightStandard(ray, n) + reflection * reflectWeight + refraction * refractWeight;
     if(config.mode == Config::PHOTON)
         color += calculateLightPhoton(ray, n);
-    return color;
+    return color * (1.0f / survival);
 }
 
 //computes the light calculations
@@ -231,11 +756,28 @@ Vector3 Raytracer::calculateLightStandard(Ray& ray, Vector3& n)
     Light* current;
     Vector3 totalColor = Vector3(0, 0, 0);
 
-    //compute the effect of every light in the scene
-    for(int i = 0; i < lights.size(); i++){
-        current = lights[i];
+    if(lightTree != NULL){
+        for(int i = 0; i < unboundedLights.size(); i++)
+            totalColor += unboundedLights[i]->illuminate(ray, n, diffuse);
+
+        //each sample is weighted by the chance of its pick, so the
+        //average matches the sum over all lights
+        Random& random = Random::local();
+        float weight = 1.0f / (float)config.lightSamples;
+        for(int i = 0; i < config.lightSamples; i++){
+            float pdf;
+            current = lightTree->sample(ray.point, random.nextFloat(), pdf);
+            if(current != NULL)
+                totalColor += current->illuminate(ray, n, diffuse) * (weight / pdf);
+        }
+    }
+    else{
+        //compute the effect of every light in the scene
+        for(int i = 0; i < lights.size(); i++){
+            current = lights[i];
 
-        totalColor += current->illuminate(ray, n, diffuse);
+            totalColor += current->illuminate(ray, n, diffuse);
+        }
     }
 
     Vector3 amb = /*calculateAO(ray, 100) * */config.ambient * diffuse;
@@ -357,6 +899,7 @@ Vector3 Raytracer::calculateReflection(Ray& ray, Vector3& n, int depth, float fa
     //compute the reflection color
     Ray reflect = Ray(ray.point, R);
     Vector3 c;
+    RAY_STATS_ADD(REFLECTION, 1);
     if(intersectRay(reflect)){
         c = ray.s->getMaterial().getReflective() * computeColor(reflect, depth + 1, factor * ray.s->getMaterial().getReflective());
     }
@@ -444,9 +987,29 @@ Vector3 Raytracer::calculateRefraction(Ray& ray, Vector3& normal, int depth, flo
 
     float reflectComp = 0.5f * (parallel * parallel + perp * perp);
 
+    //the stochastic mode follows one of the two rays with the chance
+    //of its Fresnel weight, so the weight cancels out
+    if(config.stochasticFresnel && !TIR){
+        if(Random::local().nextFloat() < reflectComp){
+            Ray reflect = Ray(ray.point, R);
+            RAY_STATS_ADD(REFLECTION, 1);
+            if(!intersectRay(reflect))
+                return config.backColor;
+            return computeColor(reflect, depth + 1, factor);
+        }
+
+        float refraction = ray.s->getMaterial().getRefraction();
+        Ray refract(ray.point, result);
+        RAY_STATS_ADD(REFRACTION, 1);
+        if(!intersectRay(refract))
+            return refraction * config.backColor;
+        return refraction * computeColor(refract, depth + 1, factor * refraction);
+    }
+
     //compute the reflection color
     Ray reflect = Ray(ray.point, R);
     Vector3 c;
+    RAY_STATS_ADD(REFLECTION, 1);
     if(intersectRay(reflect)){
         if(TIR)
             c = computeColor(reflect, depth + 1, factor);
@@ -459,11 +1022,16 @@ Vector3 Raytracer::calculateRefraction(Ray& ray, Vector3& normal, int depth, flo
     if(TIR)
         return c;
 
-    //compute the refraction color
+    //compute the refraction color, a miss sees the background through
+    //the same weights as a hit, like in the stochastic mode
     Ray refract(ray.point, result);
-    if(!intersectRay(refract))
-        return config.backColor;
-    Vector3 color = (1.0f - reflectComp) * ray.s->getMaterial().getRefraction() * computeColor(refract, depth + 1, factor  * (1.0f - reflectComp));
+    Vector3 t;
+    RAY_STATS_ADD(REFRACTION, 1);
+    if(intersectRay(refract))
+        t = computeColor(refract, depth + 1, factor  * (1.0f - reflectComp));
+    else
+        t = config.backColor;
+    Vector3 color = (1.0f - reflectComp) * ray.s->getMaterial().getRefraction() * t;
     return color + reflectComp * c;
 }
 
@@ -503,11 +1071,12 @@ float Raytracer::calculateAO(Ray& ray, int samples)
 
     float maxAngle = 75.0f;
     float m = cosf(maxAngle * 3.1415938f / 180.0f);
+    Random& random = Random::local();
 
     for(int i = 0; i < samplesY; i++){
         for(int j = 0; j < samplesY; j++){
-            float u = (float)(rand() % 1025) / 1024.0f * Yoffset + currentY;
-            float v = (float)(rand() % 1025) / 1024.0f * Xoffset;
+            float u = random.nextFloat() * Yoffset + currentY;
+            float v = random.nextFloat() * Xoffset;
             float theta = 2.0f * 3.1415938f * v;
             float factor = sqrtf(1.0f - powf(1.0f - u * (1.0f - m), 2.0f));
             Vector3 d(factor * cosf(theta + currentX), factor * sinf(theta + currentX), 1 - u * (1.0f - m));
@@ -528,75 +1097,94 @@ float Raytracer::calculateAO(Ray& ray, int samples)
     return (float)hits / ((float)samplesX * (float)samplesY);
 }
 
+//reflects about a Phong lobe around the mirror direction, the lobe is
+//importance sampled so every ray that leaves the surface counts the same,
+//emission found this way is weighed against sampling the area lights
 Vector3 Raytracer::calculateGlossyReflection(Ray& ray, Vector3& n, int depth, float factor)
 {
+    Material& material = ray.s->getMaterial();
     Vector3 view = -ray.dir;
     Vector3 R = (2.0f * Vector3::DotProduct(n, view) * n) - view;
     R.normalize();
 
-    Vector3 tangent;
-    if(fabs(R.x) >= Ray::SMALL || fabs(R.z) >= Ray::SMALL)
-        tangent = Vector3::CrossProduct(R, Vector3(0, 1, 0));
-    else
-        tangent = Vector3(1, 0, 0);
-
-    Vector3 bitangent = Vector3::CrossProduct(tangent, R);
-    tangent.normalize();
-    bitangent.normalize();
-
-    float currentX = 0.0f;
-    float currentY = 0.0f;
+    float exponent = glossyExponent(material.getGlossiness());
 
-    float Xoffset = 2.0f * 3.1415938f / (float)config.glossyReflectSampling;
-    float Yoffset = 1.0f / (float)config.glossyReflectSampling;
+    //deeper bounces follow a single ray so the cost does not multiply
+    int grid = depth == 0 ? config.glossyReflectSampling : 1;
+    int samples = grid * grid;
+    float childFactor = factor * material.getReflective() / (float)grid;
 
-    float angle = 80.0f * ray.s->getMaterial().getGlossiness();
-    float diskSize = tanf(angle * 3.1415938f / 360.0f);
+    //the lights are only sampled when the lobe's rays could see them
+    int lightSamples = 0;
+    if(depth + 1 <= config.reflectionDepth && childFactor >= config.recursionThreshold)
+        lightSamples = samples;
 
     Vector3 color(0, 0, 0);
+    Random& random = Random::local();
 
-    for(int i = 0; i < config.glossyReflectSampling; i++){
-        for(int j = 0; j < config.glossyReflectSampling; j++){
-            float u = (float)rand() / RAND_MAX * Yoffset + currentY;
-            float v = (float)rand() / RAND_MAX * Xoffset;
-            float theta = 2.0f * 3.1415938f * v;
+    for(int i = 0; i < grid; i++){
+        for(int j = 0; j < grid; j++){
+            Vector3 d = sampleLobe(R, exponent, (i + random.nextFloat()) / grid, (j + random.nextFloat()) / grid);
 
-            Vector3 d = R + (u * diskSize * cosf(theta + currentX) * tangent) + (u * diskSize * sinf(theta + currentX) * bitangent);
+            //directions below the surface are lost
+            if(Vector3::DotProduct(d, n) <= 0)
+                continue;
 
-            if(Vector3::DotProduct(d, n) > 0){
-                Ray test(ray.point, d);
-                if(intersectRay(test)){
-                    color += computeColor(test, depth + 1, factor * ray.s->getMaterial().getReflective() / (float)config.glossyReflectSampling);
-                }
-                else
-                    color += config.backColor;
-            }
-            else{
-                d = R - (u * diskSize * cosf(theta + currentX) * tangent) - (u * diskSize * sinf(theta + currentX) * bitangent);
-                Ray test(ray.point, d);
-                if(intersectRay(test)){
-                    color += computeColor(test, depth + 1, factor * ray.s->getMaterial().getReflective() / (float)config.glossyReflectSampling);
-                }
-                else
-                    color += config.backColor;
+            Ray test(ray.point, d);
+            RAY_STATS_ADD(GLOSSY, 1);
+            if(!intersectRay(test)){
+                color += config.backColor;
+                continue;
             }
 
-            currentX += Xoffset;
+            Vector3 c = computeColor(test, depth + 1, childFactor);
+            Light* light = findSurfaceLight(test.s);
+            if(light != NULL && lightSamples > 0){
+                float lobe = samples * lobePdf(R, d, exponent);
+                c = c * (lobe / (lobe + lightSamples * light->surfacePdf(ray.point, test.point)));
+            }
+            color += c;
+        }
+    }
+    color = color * (1.0f / (float)samples);
+
+    //the same emission found by sampling points on the lights, each
+    //sample is the lobe value over the combined chance of both strategies
+    for(int k = 0; k < surfaceLights.size() && lightSamples > 0; k++){
+        Light* light = surfaceLights[k];
+        Vector3 emission = light->getSurface()->getMaterial().getEmissiveColor();
+        for(int s = 0; s < lightSamples; s++){
+            Vector3 point;
+            float pdf;
+            if(!light->sampleSurface(ray.point, random.nextFloat(), random.nextFloat(), point, pdf))
+                continue;
+
+            Ray shadow(ray.point, point - ray.point);
+            Vector3 d = shadow.dir;
+            d.normalize();
+            if(Vector3::DotProduct(d, n) <= 0)
+                continue;
+
+            float lobe = lobePdf(R, d, exponent);
+            if(lobe <= 0.0f || computeShadowFactor(shadow, 1.0f - Ray::SMALL) == 0.0f)
+                continue;
+
+            color += emission * (lobe / (samples * lobe + lightSamples * pdf));
         }
-        currentX = 0.0f;
-        currentY += Yoffset;
     }
 
-    Vector3 filter = ray.s->getMaterial().getReflectColor();
+    Vector3 filter = material.getReflectColor();
     color.x *= filter.x;
     color.y *= filter.y;
     color.z *= filter.z;
 
-    return color * ray.s->getMaterial().getReflective() * (1.0f / ((float)config.glossyReflectSampling * (float)config.glossyReflectSampling));
+    return color * material.getReflective();
 }
 
 Vector3 Raytracer::calculateGlossyRefraction(Ray& ray, Vector3& normal, int depth, float factor)
 {
+    Material& material = ray.s->getMaterial();
+
     //view direction
     Vector3 view = ray.dir;
     view.normalize();
@@ -604,7 +1192,7 @@ Vector3 Raytracer::calculateGlossyRefraction(Ray& ray, Vector3& normal, int dept
     float cos1;
     float cos2;
     float n = 1.0f;
-    float nt = 1.5f;
+    float nt = material.getIOR();
 
     Vector3 result;
     bool TIR = refractVector(normal, view, result, nt);
@@ -629,6 +1217,7 @@ Vector3 Raytracer::calculateGlossyRefraction(Ray& ray, Vector3& normal, int dept
     //compute the reflection color
     Ray reflect = Ray(ray.point, refl);
     Vector3 c;
+    RAY_STATS_ADD(REFLECTION, 1);
     if(intersectRay(reflect)){
         if(TIR)
             c = computeColor(reflect, depth + 1, factor);
@@ -641,58 +1230,80 @@ Vector3 Raytracer::calculateGlossyRefraction(Ray& ray, Vector3& normal, int dept
     if(TIR)
         return c;
 
+    //the refracted rays follow a Phong lobe around the refracted direction,
+    //unlike glossy reflection the lights are not sampled as well, a shadow
+    //ray into the surface is blocked by the object it enters, so the lobe
+    //rays alone carry the emission and need no weights
+    float exponent = glossyExponent(material.getGlossiness());
+    int grid = depth == 0 ? config.glossyRefractSampling : 1;
+    float side = Vector3::DotProduct(result, normal);
+
+    Vector3 color(0, 0, 0);
+    Random& random = Random::local();
+
+    for(int i = 0; i < grid; i++){
+        for(int j = 0; j < grid; j++){
+            Vector3 d = sampleLobe(result, exponent, (i + random.nextFloat()) / grid, (j + random.nextFloat()) / grid);
+
+            //directions that leave on the incoming side are lost
+            if(Vector3::DotProduct(d, normal) * side <= 0)
+                continue;
+
+            Ray test(ray.point, d);
+            RAY_STATS_ADD(GLOSSY, 1);
+            if(intersectRay(test))
+                color += computeColor(test, depth + 1, factor * (1.0f - reflectComp) * material.getRefraction() / (float)grid);
+            else
+                color += config.backColor;
+        }
+    }
+
+    return reflectComp * c + color * (1.0f - reflectComp) * material.getRefraction() * (1.0f / (float)(grid * grid));
+}
+
+//Phong exponent whose lobe falls to half at 20 degrees times the
+//glossiness, a glossiness of 0.2 gives about 280 and 1 gives 11
+float Raytracer::glossyExponent(float glossiness)
+{
+    float halfAngle = glossiness * 20.0f * 3.1415926f / 180.0f;
+    return max(logf(0.5f) / logf(cosf(halfAngle)), 1.0f);
+}
+
+//a direction around axis drawn from the normalized Phong lobe
+Vector3 Raytracer::sampleLobe(Vector3& axis, float exponent, float u, float v)
+{
     Vector3 tangent;
-    if(fabs(result.x) >= Ray::SMALL || fabs(result.z) >= Ray::SMALL)
-        tangent = Vector3::CrossProduct(result, Vector3(0, 1, 0));
+    if(fabs(axis.x) >= Ray::SMALL || fabs(axis.z) >= Ray::SMALL)
+        tangent = Vector3::CrossProduct(axis, Vector3(0, 1, 0));
     else
         tangent = Vector3(1, 0, 0);
 
-    Vector3 bitangent = Vector3::CrossProduct(tangent, result);
+    Vector3 bitangent = Vector3::CrossProduct(tangent, axis);
     tangent.normalize();
     bitangent.normalize();
 
-    float currentX = 0.0f;
-    float currentY = 0.0f;
-
-    float Xoffset = 2.0f * 3.1415938f / (float)config.glossyReflectSampling;
-    float Yoffset = 1.0f / (float)config.glossyReflectSampling;
-
-    float angle = 80.0f * ray.s->getMaterial().getGlossiness();
-    float diskSize = tanf(angle * 3.1415938f / 360.0f);
-
-    Vector3 color(0, 0, 0);
+    float cosAlpha = powf(u, 1.0f / (exponent + 1.0f));
+    float sinAlpha = sqrtf(max(0.0f, 1.0f - cosAlpha * cosAlpha));
+    float phi = 2.0f * 3.1415926f * v;
 
-    for(int i = 0; i < config.glossyRefractSampling; i++){
-        for(int j = 0; j < config.glossyRefractSampling; j++){
-            float u = (float)rand() / RAND_MAX * Yoffset + currentY;
-            float v = (float)rand() / RAND_MAX * Xoffset;
-            float theta = 2.0f * 3.1415938f * v;
-
-            Vector3 d = result + (u * diskSize * cosf(theta + currentX) * tangent) + (u * diskSize * sinf(theta + currentX) * bitangent);
+    return (sinAlpha * cosf(phi)) * tangent + (sinAlpha * sinf(phi)) * bitangent + cosAlpha * axis;
+}
 
-            if(Vector3::DotProduct(d, normal) > 0){
-                Ray test(ray.point, d);
-                if(intersectRay(test)){
-                    color += computeColor(test, depth + 1, factor * ray.s->getMaterial().getRefraction() / (float)config.glossyRefractSampling);
-                }
-                else
-                    color += config.backColor;
-            }
-            else{
-                d = result - (u * diskSize * cosf(theta + currentX) * tangent) - (u * diskSize * sinf(theta + currentX) * bitangent);
-                Ray test(ray.point, d);
-                if(intersectRay(test)){
-                    color += computeColor(test, depth + 1, factor * ray.s->getMaterial().getRefraction() / (float)config.glossyRefractSampling);
-                }
-                else
-                    color += config.backColor;
-            }
+//density of a lobe sample in d per unit of solid angle
+float Raytracer::lobePdf(Vector3& axis, Vector3& d, float exponent)
+{
+    float cosAlpha = Vector3::DotProduct(axis, d);
+    if(cosAlpha <= 0.0f)
+        return 0.0f;
+    return (exponent + 1.0f) / (2.0f * 3.1415926f) * powf(cosAlpha, exponent);
+}
 
-            currentX += Xoffset;
-        }
-        currentX = 0.0f;
-        currentY += Yoffset;
+//the light whose surface the shape is, if any
+Light* Raytracer::findSurfaceLight(Shape* shape)
+{
+    for(int i = 0; i < surfaceLights.size(); i++){
+        if(surfaceLights[i]->getSurface() == shape)
+            return surfaceLights[i];
     }
-
-    return reflectComp * c + color * (1.0f - reflectComp) * ray.s->getMaterial().getRefraction() * (1.0f / ((float)config.glossyRefractSampling * (float)config.glossyRefractSampling));
+    return NULL;
 }
@@ -17,6 +17,8 @@
 #include "image.h"
 
 #include "photonMap.h"
+#include "bvh.h"
+#include "lightTree.h"
 
 struct Config
 {
@@ -39,10 +41,50 @@ struct Config
 
     float gamma;
 
+    //width and height in pixels of the tiles traced as ray packets
+    int packetSize;
+
+    //lights picked from the light tree at every shading point,
+    //0 evaluates every light, lights without a position always are
+    int lightSamples;
+
+    //light contributions at or below this are dropped without tracing
+    //their shadow rays, zero only skips lights that add nothing, it is
+    //compared with all a light adds to the shading point, so the samples
+    //of an area light are summed first and lights picked from the light
+    //tree leave out the weight of the pick
+    float shadowThreshold;
+
+    //area lights trace their corner and middle strata first and only
+    //sample the rest when those disagree about the visibility
+    bool adaptiveShadows;
+
+    //width and height in texels of the shadow maps that replace the
+    //shadow rays of directional lights, 0 traces the rays
+    int shadowMapSize;
+
+    //glass and mirrors follow one randomly picked ray per bounce and end
+    //faint paths by russian roulette, pixel sampling averages the noise
+    bool stochasticFresnel;
+
+    //seed of every random sequence, the same seed renders the same image
+    unsigned int seed;
+
     Camera* camera;
     Sampler* sampler;
 };
 
+//wall clock seconds spent in each phase of loading a scene,
+//building the mesh and scene structures is not counted as parsing
+struct SetupTimes
+{
+    float parse;
+    float build;
+    float photon;
+};
+
+struct RayPacket;
+
 struct Hitpoint
 {
     float t;
@@ -51,6 +93,7 @@ struct Hitpoint
     Shape* s;
     float f1;
     float f2;
+    int index;
 };
 
 class Raytracer
@@ -63,13 +106,24 @@ class Raytracer
         bool loadScene(string);
 
         Vector3 tracePixel(int, int);
+        void traceTile(int, int, int, int, Vector3*, Sampler*);
         Vector3 traceRay(Ray&);
+        void tracePacket(RayPacket&, Vector3*);
         bool intersectRay(Ray&);
+        void intersectPacket(RayPacket&);
         float computeShadowFactor(Ray&, float);
+        float occluderDistance(Ray&);
         Vector3 calculateShading(Ray&, Vector3&, Vector3&, Vector3&);
 
         int getWidth(void);
         int getHeight(void);
+        int getPacketSize(void);
+        float getShadowThreshold(void);
+        bool getAdaptiveShadows(void);
+        void setPacketSize(int);
+        Sampler* createSampler(void);
+        SetupTimes& getSetupTimes(void);
+        vector<Shape*>& getObjects(void);
 
         void addObject(Shape*);
         void addLight(Light*);
@@ -77,6 +131,14 @@ class Raytracer
     private:
 
         void setupPhotonMap(void);
+        void setupSceneTree(void);
+        void setupLightTree(void);
+        void setupShadowMaps(void);
+
+        void intersectObject(Shape*, Ray&, Hitpoint&, Shape*&);
+        bool occludesRay(Shape*, Ray&, float);
+        bool testObject(Shape*, Ray&, Hitpoint&, float);
+        void testPacket(Shape*, RayPacket&, int);
 
         Vector3 computeColor(Ray&, int, float);
         Vector3 calculateLightStandard(Ray&, Vector3&);
@@ -86,14 +148,29 @@ class Raytracer
         Vector3 calculateRefraction(Ray&, Vector3&, int, float);
         bool refractVector(Vector3&, Vector3&, Vector3&, float);
         Vector3 calculateGlossyRefraction(Ray&, Vector3&, int, float);
+        float glossyExponent(float);
+        Vector3 sampleLobe(Vector3&, float, float, float);
+        float lobePdf(Vector3&, Vector3&, float);
+        Light* findSurfaceLight(Shape*);
         float calculateAO(Ray&, int);
 
+        void seedRandom(int);
         void gammaCorrection(Vector3&);
 
         vector<Shape*> objects;
         vector<Light*> lights;
 
+        BVH* sceneTree;
+        vector<Shape*> unbounded;
+
+        LightTree* lightTree;
+        vector<Light*> unboundedLights;
+
+        //lights with an emissive surface that glossy rays can hit
+        vector<Light*> surfaceLights;
+
         Config config;
+        SetupTimes setupTimes;
         Parser* parser;
         PhotonMap* photonMap;
 };
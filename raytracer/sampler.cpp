@@ -1,26 +1,67 @@
 #include "sampler.h"
 #include "raytracer.h"
+#include "packet.h"
+#include "random.h"
 
-Sampler::Sampler(Raytracer* r, Config& c) : raytracer(r), config(c){}
+Sampler::Sampler(Raytracer* r, Config& c) : raytracer(r), config(c), cameraRays(0){}
+
+//a copy starts counting its own rays
+Sampler::Sampler(const Sampler& s) : raytracer(s.raytracer), config(s.config), cameraRays(0){}
+
+long long Sampler::getRayCount(void)
+{
+    return cameraRays;
+}
+
+bool Sampler::samplePacket(int x, int y, int width, int height, Vector3* colors)
+{
+    return false;
+}
 
 simpleSampler::simpleSampler(Raytracer* r, Config& c) :
     Sampler(r, c)
 {}
 
+Sampler* simpleSampler::clone(void)
+{
+    return new simpleSampler(*this);
+}
+
 Vector3 simpleSampler::samplePixel(int x, int y)
 {
     Ray ray;
     config.camera->computeRay(x, 0.5f, y, 0.5f, ray);
 
+    cameraRays++;
     return raytracer->traceRay(ray);
 }
 
+//one ray through the center of every pixel of the tile
+bool simpleSampler::samplePacket(int x, int y, int width, int height, Vector3* colors)
+{
+    RayPacket packet;
+    packet.size = width * height;
+    for(int i = 0; i < height; i++){
+        for(int j = 0; j < width; j++)
+            config.camera->computeRay(x + j, 0.5f, y + i, 0.5f, packet.rays[i * width + j]);
+    }
+
+    cameraRays += packet.size;
+    raytracer->tracePacket(packet, colors);
+    return true;
+}
+
 uniformSampler::uniformSampler(Raytracer* r, Config& c, int s) :
     Sampler(r, c)
 {
     sampling = s;
 }
 
+Sampler* uniformSampler::clone(void)
+{
+    return new uniformSampler(*this);
+}
+
 Vector3 uniformSampler::samplePixel(int x, int y)
 {
     Vector3 color = Vector3(0, 0, 0);
@@ -44,6 +85,7 @@ Vector3 uniformSampler::samplePixel(int x, int y)
             Ray ray;
             config.camera->computeRay(x, Xoffset, y, Yoffset, ray);
 
+            cameraRays++;
             color += raytracer->traceRay(ray);
 
             Xoffset += Xincrement;
@@ -57,12 +99,59 @@ Vector3 uniformSampler::samplePixel(int x, int y)
     return color;
 }
 
+//every sample position is traced as one packet over the whole tile,
+//the samples are summed in the same order as samplePixel
+bool uniformSampler::samplePacket(int x, int y, int width, int height, Vector3* colors)
+{
+    int num = width * height;
+    for(int i = 0; i < num; i++)
+        colors[i] = Vector3(0, 0, 0);
+
+    float initX = 1.0f / (2.0f * (float)sampling);
+    float Xoffset;
+    float Yoffset = 1.0f / (2.0f * (float)sampling);
+
+    float Xincrement = 1.0f / (float)sampling;
+    float Yincrement = 1.0f / (float)sampling;
+
+    RayPacket packet;
+    packet.size = num;
+    Vector3 results[RayPacket::maxSize];
+    for(int i = 0; i < sampling; i++){
+        Xoffset = initX;
+        for(int j = 0; j < sampling; j++){
+            for(int py = 0; py < height; py++){
+                for(int px = 0; px < width; px++)
+                    config.camera->computeRay(x + px, Xoffset, y + py, Yoffset, packet.rays[py * width + px]);
+            }
+
+            cameraRays += packet.size;
+            raytracer->tracePacket(packet, results);
+            for(int k = 0; k < num; k++)
+                colors[k] += results[k];
+
+            Xoffset += Xincrement;
+        }
+        Yoffset += Yincrement;
+    }
+
+    for(int i = 0; i < num; i++)
+        colors[i] /= (sampling * sampling);
+
+    return true;
+}
+
 jitterSampler::jitterSampler(Raytracer* r, Config& c, int s) :
     Sampler(r, c)
 {
     sampling = s;
 }
 
+Sampler* jitterSampler::clone(void)
+{
+    return new jitterSampler(*this);
+}
+
 Vector3 jitterSampler::samplePixel(int x, int y)
 {
     Vector3 color = Vector3(0, 0, 0);
@@ -75,19 +164,22 @@ Vector3 jitterSampler::samplePixel(int x, int y)
     float Xincrement = 1.0f / (float)sampling;
     float Yincrement = 1.0f / (float)sampling;
 
+    Random& random = Random::local();
+
     //determine the average color in the pixel
     //based on the amount of super sampling
     for(int i = 0; i < sampling; i++){
         Xoffset = 0.0f;
         for(int j = 0; j < sampling; j++){
 
-            float randX = (float)(rand() % 101) / 100.0f;
-            float randY = (float)(rand() % 101) / 100.0f;
+            float randX = random.nextFloat();
+            float randY = random.nextFloat();
 
             //determine the color at the sample
             Ray ray;
             config.camera->computeRay(x, Xoffset + randX * Xincrement, y, Yoffset + randY * Yincrement, ray);
 
+            cameraRays++;
             color += raytracer->traceRay(ray);
 
             Xoffset += Xincrement;
@@ -114,17 +206,22 @@ void adaptiveSampler::setupCache(void)
     cacheSize = 2;
     for(int i = 0; i < sampling; i++, cacheSize += cacheSize - 1);
 
-    samplerCache = new samplerNode*[cacheSize];
-    for(int i = 0; i < cacheSize; i++)
-        samplerCache[i] = new samplerNode[cacheSize];
-
+    samplerCache.resize(cacheSize * cacheSize);
     for(int i = 0; i < cacheSize; i++){
         for(int j = 0; j < cacheSize; j++){
-            samplerCache[j][i].id = -1;
-            samplerCache[j][i].xOffset = (float)j / (float)(cacheSize - 1);
-            samplerCache[j][i].yOffset = (float)i / (float)(cacheSize - 1);
+            samplerNode& node = samplerCache[j * cacheSize + i];
+            node.id = -1;
+            node.xOffset = (float)j / (float)(cacheSize - 1);
+            node.yOffset = (float)i / (float)(cacheSize - 1);
         }
     }
+    pixelID = 0;
+}
+
+//the copy gets its own cache, ids only need to be unique per cache
+Sampler* adaptiveSampler::clone(void)
+{
+    return new adaptiveSampler(*this);
 }
 
 bool adaptiveSampler::checkVariance(Vector3& v1, Vector3& v2)
@@ -137,9 +234,8 @@ bool adaptiveSampler::checkVariance(Vector3& v1, Vector3& v2)
 
 Vector3 adaptiveSampler::samplePixel(int x, int y)
 {
-    static int i = 0;
-    i++;
-    return recursiveSample(x, y, 0, 0, cacheSize - 1, 0, i);
+    pixelID++;
+    return recursiveSample(x, y, 0, 0, cacheSize - 1, 0, pixelID);
 }
 
 Vector3 adaptiveSampler::recursiveSample(int pixelX, int pixelY, int x, int y, int width, int depth, int ID)
@@ -159,14 +255,15 @@ Vector3 adaptiveSampler::recursiveSample(int pixelX, int pixelY, int x, int y, i
         else
             currentY = y + width;
 
-        if(samplerCache[currentX][currentY].id == ID)
-            colors[i] = samplerCache[currentX][currentY].color;
+        samplerNode& node = samplerCache[currentX * cacheSize + currentY];
+        if(node.id == ID)
+            colors[i] = node.color;
         else{
-            config.camera->computeRay(pixelX, samplerCache[currentX][currentY].xOffset,
-                                      pixelY, samplerCache[currentX][currentY].yOffset, r);
+            config.camera->computeRay(pixelX, node.xOffset, pixelY, node.yOffset, r);
+            cameraRays++;
             colors[i] = raytracer->traceRay(r);
-            samplerCache[currentX][currentY].id = ID;
-            samplerCache[currentX][currentY].color = colors[i];
+            node.id = ID;
+            node.color = colors[i];
         }
 
         c += colors[i];
@@ -1,6 +1,7 @@
 #ifndef SAMPLERS_H_INCLUDED
 #define SAMPLERS_H_INCLUDED
 
+#include <vector>
 #include "vector.h"
 
 class Raytracer;
@@ -11,14 +12,28 @@ class Sampler
     public:
 
         Sampler(Raytracer*, Config&);
+        Sampler(const Sampler&);
         virtual ~Sampler(){}
 
         virtual Vector3 samplePixel(int, int) =0;
 
+        //copy for a single render thread, samplers that keep
+        //state between pixels must not share it across threads
+        virtual Sampler* clone(void) =0;
+
+        //samples a tile of pixels with ray packets, samplers that
+        //can not trace their rays together return false
+        virtual bool samplePacket(int, int, int, int, Vector3*);
+
+        //number of camera rays traced through this sampler
+        long long getRayCount(void);
+
     protected:
 
         Raytracer* raytracer;
         Config& config;
+
+        long long cameraRays;
 };
 
 class simpleSampler : public Sampler
@@ -27,6 +42,8 @@ class simpleSampler : public Sampler
 
         simpleSampler(Raytracer*, Config&);
         Vector3 samplePixel(int, int);
+        Sampler* clone(void);
+        bool samplePacket(int, int, int, int, Vector3*);
 };
 
 class uniformSampler : public Sampler
@@ -35,6 +52,8 @@ class uniformSampler : public Sampler
 
         uniformSampler(Raytracer*, Config&, int);
         Vector3 samplePixel(int, int);
+        Sampler* clone(void);
+        bool samplePacket(int, int, int, int, Vector3*);
 
     private:
 
@@ -47,6 +66,7 @@ class jitterSampler : public Sampler
 
         jitterSampler(Raytracer*, Config&, int);
         Vector3 samplePixel(int, int);
+        Sampler* clone(void);
 
     private:
 
@@ -59,6 +79,7 @@ class adaptiveSampler : public Sampler
 
         adaptiveSampler(Raytracer*, Config&, int, Vector3);
         Vector3 samplePixel(int, int);
+        Sampler* clone(void);
 
     private:
 
@@ -73,8 +94,11 @@ class adaptiveSampler : public Sampler
         int sampling;
         Vector3 threshold;
 
+        //corner samples of the current pixel, stored column by column,
+        //every clone has its own so threads never share a cache line
         int cacheSize;
-        samplerNode** samplerCache;
+        vector<samplerNode> samplerCache;
+        int pixelID;
         void setupCache(void);
 
         Vector3 recursiveSample(int, int, int, int, int, int, int);
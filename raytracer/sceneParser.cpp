@@ -1,5 +1,6 @@
 #include "sceneParser.h"
 #include "raytracer.h"
+#include "timer.h"
 
 SceneParser::SceneParser(Raytracer* r, Config& c, Parser* p) : config(c)
 {
@@ -90,6 +91,42 @@ void SceneParser::parseConfig(void)
 
                 config.glossyRefractSampling = sampling;
             }
+            else if(tokenText == "packetSize"){
+                int size;
+                parseNumber(size);
+
+                //a packet holds at most 8x8 rays
+                config.packetSize = max(1, min(size, 8));
+            }
+            else if(tokenText == "lightSamples"){
+                int samples;
+                parseNumber(samples);
+                config.lightSamples = max(0, samples);
+            }
+            else if(tokenText == "adaptiveShadows"){
+                int adaptive;
+                parseNumber(adaptive);
+                config.adaptiveShadows = adaptive != 0;
+            }
+            else if(tokenText == "shadowMapSize"){
+                int size;
+                parseNumber(size);
+                config.shadowMapSize = max(0, size);
+            }
+            else if(tokenText == "stochasticFresnel"){
+                int stochastic;
+                parseNumber(stochastic);
+                config.stochasticFresnel = stochastic != 0;
+            }
+            else if(tokenText == "shadowThreshold"){
+                parseNumber(config.shadowThreshold);
+            }
+            else if(tokenText == "seed"){
+                int seed;
+                parseNumber(seed);
+
+                config.seed = seed;
+            }
             else if(tokenText == "uniform"){
                 int level;
                 parseNumber(level);
@@ -279,17 +316,37 @@ void SceneParser::parseMesh(void)
     parseToken(Scanner::String);
 
     string fileName = scanner.tokenText();
-    vector<Triangle*>* newMesh = new vector<Triangle*>;
-    vector<Vector3>* newPoints = new vector<Vector3>;
-    vector<Vector3>* newNormals = new vector<Vector3>;
+    TriangleStore* newMesh = new TriangleStore;
 
-    if(!parser->loadObj(fileName, *newMesh, *newPoints, *newNormals))
+    if(!parser->loadObj(fileName, *newMesh))
         errorFlag = true;
 
-    Mesh* m = new Mesh(newMesh, newPoints, newNormals);
+    advance();
+
+    //optional acceleration structure, defaults to the BVH
+    Accelerator::Type type = Accelerator::SAH;
+    if(currentToken == Scanner::Id){
+        string accel = scanner.tokenText();
+        bool isAccel = true;
+        if(accel == "bvh")
+            type = Accelerator::SAH;
+        else if(accel == "octree")
+            type = Accelerator::OCTREE;
+        else if(accel == "linear")
+            type = Accelerator::NONE;
+        else
+            isAccel = false;
+
+        if(isAccel)
+            advance();
+    }
+
+    //the acceleration structure is built with the mesh
+    Timer timer;
+    Mesh* m = new Mesh(newMesh, type);
+    raytracer->getSetupTimes().build += timer.elapsed();
     raytracer->addObject(m);
 
-    advance();
     parseMaterial(m);
     parseTransform(m);
 
@@ -508,11 +565,12 @@ void SceneParser::parseAreaLight(void)
     int samplesy;
     parseNumber(samplesy);
 
-    Light* l = new AreaLight(raytracer, pos, right, up, color, falloff, intensity, samplesx, samplesy);
-    raytracer->addLight(l);
-
+    AreaLight* l = new AreaLight(raytracer, pos, right, up, color, falloff, intensity, samplesx, samplesy);
     Plane* p = new Plane(pos + up * 0.5f + right * 0.5f, right, right.getLength() / 2.0f, up, up.getLength() / 2.0f);
     p->getMaterial().setEmissive(color * intensity);
+    l->setSurface(p);
+
+    raytracer->addLight(l);
     raytracer->addObject(p);
 
     parseToken(Scanner::RightCurly);
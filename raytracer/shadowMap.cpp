@@ -0,0 +1,94 @@
+#include "shadowMap.h"
+#include "raytracer.h"
+#include "ray.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+ShadowMap::ShadowMap(int mapSize)
+{
+    size = mapSize;
+}
+
+//casts a ray from every texel towards the scene, dir points at the light
+void ShadowMap::createMap(Raytracer* raytracer, Vector3 dir, Vector3& minBound, Vector3& maxBound)
+{
+    direction = dir;
+    direction.normalize();
+
+    //any two axes across the light will do
+    Vector3 helper = fabs(direction.x) < 0.9f ? Vector3(1, 0, 0) : Vector3(0, 1, 0);
+    u = Vector3::CrossProduct(helper, direction);
+    u.normalize();
+    v = Vector3::CrossProduct(direction, u);
+
+    //extent of the bounds corners along the three axes
+    float uMin = FLT_MAX, uMax = -FLT_MAX;
+    float vMin = FLT_MAX, vMax = -FLT_MAX;
+    float height = -FLT_MAX;
+    for(int i = 0; i < 8; i++){
+        Vector3 corner(i & 1 ? maxBound.x : minBound.x, i & 2 ? maxBound.y : minBound.y, i & 4 ? maxBound.z : minBound.z);
+        float cu = Vector3::DotProduct(corner, u);
+        float cv = Vector3::DotProduct(corner, v);
+        uMin = min(uMin, cu);
+        uMax = max(uMax, cu);
+        vMin = min(vMin, cv);
+        vMax = max(vMax, cv);
+        height = max(height, Vector3::DotProduct(corner, direction));
+    }
+
+    //start a little above the bounds so nothing inside them is missed
+    float margin = (maxBound - minBound).getLength() * 0.01f + Ray::SMALL;
+    uStep = max((uMax - uMin + 2.0f * margin) / size, Ray::SMALL);
+    vStep = max((vMax - vMin + 2.0f * margin) / size, Ray::SMALL);
+    origin = u * (uMin - margin) + v * (vMin - margin) + direction * (height + margin);
+
+    //a surface tilted away from the light differs from its neighbour
+    //texels by about a texel, without the bias it would shadow itself
+    bias = 2.5f * max(uStep, vStep) + Ray::SMALL;
+
+    depths.resize(size * size);
+
+    int threads = max((int)std::thread::hardware_concurrency(), 1);
+    int rows = (size + threads - 1) / threads;
+    vector<std::thread> workers;
+    for(int i = 1; i < threads; i++)
+        workers.push_back(std::thread(&ShadowMap::castRows, this, raytracer, min(i * rows, size), min((i + 1) * rows, size)));
+    castRows(raytracer, 0, min(rows, size));
+    for(int i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+void ShadowMap::castRows(Raytracer* raytracer, int first, int last)
+{
+    for(int y = first; y < last; y++){
+        for(int x = 0; x < size; x++){
+            Ray ray(origin + u * ((x + 0.5f) * uStep) + v * ((y + 0.5f) * vStep), -direction);
+            depths[y * size + x] = raytracer->occluderDistance(ray);
+        }
+    }
+}
+
+//share of the 3x3 texels around the point that see the light, or -1
+//when the point lies outside the map and needs a shadow ray
+float ShadowMap::lookup(Vector3& point)
+{
+    Vector3 rel = point - origin;
+    float depth = -Vector3::DotProduct(rel, direction);
+    int x = (int)floorf(Vector3::DotProduct(rel, u) / uStep);
+    int y = (int)floorf(Vector3::DotProduct(rel, v) / vStep);
+    if(depth < 0.0f || x < 0 || x >= size || y < 0 || y >= size)
+        return -1.0f;
+
+    int lit = 0;
+    for(int i = -1; i <= 1; i++){
+        int row = max(0, min(y + i, size - 1));
+        for(int j = -1; j <= 1; j++){
+            int column = max(0, min(x + j, size - 1));
+            if(depth <= depths[row * size + column] + bias)
+                lit++;
+        }
+    }
+
+    return lit / 9.0f;
+}
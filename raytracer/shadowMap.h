@@ -0,0 +1,43 @@
+#ifndef SHADOWMAP_H_INCLUDED
+#define SHADOWMAP_H_INCLUDED
+
+#include <vector>
+#include "vector.h"
+
+using namespace std;
+
+class Raytracer;
+
+//depth of the scene as seen from a directional light, the map is ray
+//cast once over the bounds of the bounded objects and shading points
+//filter a few texels around them instead of tracing a shadow ray
+class ShadowMap
+{
+    public:
+
+        ShadowMap(int);
+
+        void createMap(Raytracer*, Vector3, Vector3&, Vector3&);
+
+        float lookup(Vector3&);
+
+    private:
+
+        void castRows(Raytracer*, int, int);
+
+        int size;
+
+        //the map plane starts at origin and spans u and v, the rays
+        //leave it along the light's direction
+        Vector3 origin;
+        Vector3 direction;
+        Vector3 u;
+        Vector3 v;
+        float uStep;
+        float vStep;
+        float bias;
+
+        vector<float> depths;
+};
+
+#endif // SHADOWMAP_H_INCLUDED
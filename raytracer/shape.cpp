@@ -1,15 +1,18 @@
 #include "shape.h"
 #include "raytracer.h"
+#include "packet.h"
 
 Shape::Shape(void) : isTransformed(false), material(this){}
 
-bool Shape::intersectRay(Ray& ray, Hitpoint& hit)
+//the interval is in units of the ray's direction, the transform keeps
+//the direction's length in object space so it applies unchanged
+bool Shape::intersectRay(Ray& ray, Hitpoint& hit, float tMin, float tMax)
 {
     if(isTransformed){
         Ray newRay;
         Matrix4x4::transformPoint(invTrans, newRay.origin, ray.origin);
         Matrix4x4::transformDirection(invTrans, newRay.dir, ray.dir);
-        if(this->Intersection(newRay, hit)){
+        if(this->Intersection(newRay, hit, tMin, tMax)){
             Vector3 point;
             point = newRay.origin + hit.t * newRay.dir;
             Matrix4x4::transformPoint(trans, hit.point, point);
@@ -17,13 +20,91 @@ bool Shape::intersectRay(Ray& ray, Hitpoint& hit)
         }
         return false;
     }
-    if(this->Intersection(ray, hit)){
+    if(this->Intersection(ray, hit, tMin, tMax)){
         hit.point = ray.origin + hit.t * ray.dir;
         return true;
     }
     return false;
 }
 
+//true when the shape blocks the ray before range, shapes with an
+//accelerator stop at the first hit instead of looking for the closest
+bool Shape::occludesRay(Ray& ray, float range)
+{
+    if(isTransformed){
+        Ray newRay;
+        Matrix4x4::transformPoint(invTrans, newRay.origin, ray.origin);
+        Matrix4x4::transformDirection(invTrans, newRay.dir, ray.dir);
+        return this->Occlusion(newRay, range);
+    }
+    return this->Occlusion(ray, range);
+}
+
+//shapes without an any hit test use the closest hit
+bool Shape::Occlusion(Ray& ray, float range)
+{
+    Hitpoint hit;
+    return this->Intersection(ray, hit, Ray::SMALL, range);
+}
+
+//intersects the active rays of the packet, rays that hit the shape closer
+//than their current hit get the new hit and this shape
+void Shape::intersectPacket(RayPacket& packet)
+{
+    bool found[RayPacket::maxSize];
+    for(int i = 0; i < packet.size; i++)
+        found[i] = false;
+
+    if(isTransformed){
+        RayPacket local;
+        local.size = packet.size;
+        for(int i = 0; i < packet.size; i++){
+            local.active[i] = packet.active[i];
+            if(!packet.active[i])
+                continue;
+            Matrix4x4::transformPoint(invTrans, local.rays[i].origin, packet.rays[i].origin);
+            Matrix4x4::transformDirection(invTrans, local.rays[i].dir, packet.rays[i].dir);
+            local.hits[i].t = packet.hits[i].t;
+        }
+        local.setup();
+
+        this->PacketIntersection(local, found);
+
+        for(int i = 0; i < packet.size; i++){
+            if(!found[i])
+                continue;
+            Vector3 point = local.rays[i].origin + local.hits[i].t * local.rays[i].dir;
+            packet.hits[i] = local.hits[i];
+            Matrix4x4::transformPoint(trans, packet.hits[i].point, point);
+            packet.shapes[i] = this;
+        }
+        return;
+    }
+
+    this->PacketIntersection(packet, found);
+
+    for(int i = 0; i < packet.size; i++){
+        if(!found[i])
+            continue;
+        packet.hits[i].point = packet.rays[i].origin + packet.hits[i].t * packet.rays[i].dir;
+        packet.shapes[i] = this;
+    }
+}
+
+//shapes without a packet test intersect the rays one at a time
+void Shape::PacketIntersection(RayPacket& packet, bool* found)
+{
+    Hitpoint hit;
+    for(int i = 0; i < packet.size; i++){
+        if(!packet.active[i])
+            continue;
+        if(this->Intersection(packet.rays[i], hit, Ray::SMALL, packet.hits[i].t)){
+            packet.hits[i] = hit;
+            found[i] = true;
+        }
+    }
+}
+
 Vector3 Shape::computeNormal(Ray& ray)
 {
     if(material.normalsAltered()){
@@ -80,6 +161,36 @@ Vector3 Shape::computeNormal(Ray& ray)
     return n;
 }
 
+//computes the world space bounds, returns false for unbounded shapes
+bool Shape::computeBounds(Vector3& minBound, Vector3& maxBound)
+{
+    Vector3 objMin, objMax;
+    if(!this->getBounds(objMin, objMax))
+        return false;
+
+    if(!isTransformed){
+        minBound = objMin;
+        maxBound = objMax;
+        return true;
+    }
+
+    //bound the transformed corners of the object space box
+    minBound = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+    maxBound = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for(int i = 0; i < 8; i++){
+        Vector3 corner((i & 1) ? objMax.x : objMin.x,
+                       (i & 2) ? objMax.y : objMin.y,
+                       (i & 4) ? objMax.z : objMin.z);
+        Vector3 p;
+        Matrix4x4::transformPoint(trans, p, corner);
+        for(int k = 0; k < 3; k++){
+            minBound.elements[k] = min(minBound.elements[k], p.elements[k]);
+            maxBound.elements[k] = max(maxBound.elements[k], p.elements[k]);
+        }
+    }
+    return true;
+}
+
 Material& Shape::getMaterial(void)
 {
     return material;
@@ -7,6 +7,7 @@
 #include "material.h"
 
 struct Hitpoint;
+struct RayPacket;
 
 class Shape
 {
@@ -17,8 +18,11 @@ class Shape
 
         virtual void getUV(Vector3&, Ray&, float&, float&) =0;
 
-        bool intersectRay(Ray&, Hitpoint&);
+        bool intersectRay(Ray&, Hitpoint&, float, float);
+        bool occludesRay(Ray&, float);
+        void intersectPacket(RayPacket&);
         Vector3 computeNormal(Ray&);
+        bool computeBounds(Vector3&, Vector3&);
 
         Material& getMaterial(void);
 
@@ -31,8 +35,13 @@ class Shape
 
     private:
 
-        virtual bool Intersection(Ray&, Hitpoint&) =0;
+        //nearest hit inside the open interval (tMin, tMax), anything
+        //outside it is rejected before the hit details are computed
+        virtual bool Intersection(Ray&, Hitpoint&, float, float) =0;
+        virtual bool Occlusion(Ray&, float);
+        virtual void PacketIntersection(RayPacket&, bool*);
         virtual Vector3 getNormal(Ray&) =0;
+        virtual bool getBounds(Vector3&, Vector3&) =0;
 
         enum Transform {TRANS, SCALE, ROT};
 
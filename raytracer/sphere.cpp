@@ -8,7 +8,7 @@ Sphere::Sphere(Vector3 c, float r)
     radius = r;
 }
 
-bool Sphere::Intersection(Ray& r, Hitpoint& h)
+bool Sphere::Intersection(Ray& r, Hitpoint& h, float tMin, float tMax)
 {
     //compute the A, B, and C values of the polynomial
     float B = Vector3::DotProduct(2.0 * r.dir, r.origin - center);
@@ -33,10 +33,13 @@ bool Sphere::Intersection(Ray& r, Hitpoint& h)
         t2 = temp;
     }
 
-    if(t1 < Ray::SMALL)
+    //the far root when the near one is behind the interval start
+    if(t1 > tMin && t1 < tMax)
+        h.t = t1;
+    else if(t2 > tMin && t2 < tMax)
         h.t = t2;
     else
-        h.t = t1;
+        return false;
 
     return true;
 }
@@ -52,6 +55,13 @@ Vector3 Sphere::getNormal(Ray& ray)
     return ray.point - center;
 }
 
+bool Sphere::getBounds(Vector3& minBound, Vector3& maxBound)
+{
+    minBound = center - Vector3(radius, radius, radius);
+    maxBound = center + Vector3(radius, radius, radius);
+    return true;
+}
+
 void Sphere::getUV(Vector3& point, Ray& ray, float& u, float& v)
 {
     Vector3 n = point - center;
@@ -17,8 +17,9 @@ class Sphere : public Shape
 
     private:
 
-        bool Intersection(Ray&, Hitpoint&);
+        bool Intersection(Ray&, Hitpoint&, float, float);
         Vector3 getNormal(Ray&);
+        bool getBounds(Vector3&, Vector3&);
 
         Vector3 center;
         float radius;
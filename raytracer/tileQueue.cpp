@@ -0,0 +1,65 @@
+#include "tileQueue.h"
+
+//the capacity is fixed, it has to cover every tile that can be queued at once
+TileQueue::TileQueue(int capacity)
+{
+    int size = 1;
+    while(size < capacity)
+        size *= 2;
+
+    items = new std::atomic<int>[size];
+    mask = size - 1;
+    top.store(0);
+    bottom.store(0);
+}
+
+TileQueue::~TileQueue(void)
+{
+    delete[] items;
+}
+
+void TileQueue::push(int tile)
+{
+    long long b = bottom.load(std::memory_order_relaxed);
+    items[b & mask].store(tile, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+//takes the most recently pushed tile, the owner keeps working close to
+//the tiles it rendered last
+bool TileQueue::pop(int& tile)
+{
+    long long b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = top.load(std::memory_order_relaxed);
+
+    if(t > b){
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    tile = items[b & mask].load(std::memory_order_relaxed);
+    if(t < b)
+        return true;
+
+    //last tile, race the thieves for it
+    bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return won;
+}
+
+//takes the oldest tile, which is the furthest from where the owner works
+bool TileQueue::steal(int& tile)
+{
+    long long t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long b = bottom.load(std::memory_order_acquire);
+
+    if(t >= b)
+        return false;
+
+    tile = items[t & mask].load(std::memory_order_relaxed);
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
@@ -0,0 +1,31 @@
+#ifndef TILEQUEUE_H_INCLUDED
+#define TILEQUEUE_H_INCLUDED
+
+#include <atomic>
+
+//lock free work stealing deque of tile indices (Chase-Lev), only the
+//owning thread pushes and pops at the bottom, any thread steals from the top
+class TileQueue
+{
+    public:
+
+        TileQueue(int);
+        ~TileQueue(void);
+
+        void push(int);
+        bool pop(int&);
+        bool steal(int&);
+
+    private:
+
+        TileQueue(const TileQueue&);
+        TileQueue& operator= (const TileQueue&);
+
+        std::atomic<int>* items;
+        int mask;
+
+        std::atomic<long long> top;
+        std::atomic<long long> bottom;
+};
+
+#endif // TILEQUEUE_H_INCLUDED
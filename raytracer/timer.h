@@ -0,0 +1,33 @@
+#ifndef TIMER_H_INCLUDED
+#define TIMER_H_INCLUDED
+
+#include <chrono>
+
+//wall clock stopwatch, started on construction
+class Timer
+{
+    public:
+
+        Timer(void)
+        {
+            restart();
+        }
+
+        void restart(void)
+        {
+            startTime = std::chrono::steady_clock::now();
+        }
+
+        //seconds since the last restart
+        float elapsed(void)
+        {
+            std::chrono::duration<float> d = std::chrono::steady_clock::now() - startTime;
+            return d.count();
+        }
+
+    private:
+
+        std::chrono::steady_clock::time_point startTime;
+};
+
+#endif // TIMER_H_INCLUDED
@@ -0,0 +1,140 @@
+#include "trace.h"
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+std::atomic<bool> Trace::enabled(false);
+std::mutex Trace::lock;
+std::vector<Trace::Event> Trace::events;
+std::vector<std::pair<int, std::string> > Trace::threadNames;
+std::atomic<int> Trace::nextThread(0);
+
+static std::chrono::steady_clock::time_point origin;
+
+//begun events of the calling thread, ended ones move to the shared list
+static thread_local std::vector<std::pair<std::string, std::string> > openNames;
+static thread_local std::vector<double> openStarts;
+
+//clears anything recorded before and starts the clock at zero
+void Trace::start(void)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    events.clear();
+    origin = std::chrono::steady_clock::now();
+    enabled = true;
+}
+
+void Trace::stop(void)
+{
+    enabled = false;
+}
+
+bool Trace::isEnabled(void)
+{
+    return enabled;
+}
+
+void Trace::begin(const std::string& name, const std::string& detail)
+{
+    if(!enabled)
+        return;
+    openNames.push_back(std::make_pair(name, detail));
+    openStarts.push_back(now());
+}
+
+//ends the last event begun on the calling thread
+void Trace::end(void)
+{
+    if(openStarts.empty())
+        return;
+
+    Event e;
+    e.name = openNames.back().first;
+    e.detail = openNames.back().second;
+    e.start = openStarts.back();
+    e.duration = now() - e.start;
+    e.thread = threadId();
+    openNames.pop_back();
+    openStarts.pop_back();
+
+    if(!enabled)
+        return;
+    std::lock_guard<std::mutex> guard(lock);
+    events.push_back(e);
+}
+
+//labels the calling thread's row in the viewer
+void Trace::setThreadName(const std::string& name)
+{
+    int id = threadId();
+    std::lock_guard<std::mutex> guard(lock);
+    for(int i = 0; i < threadNames.size(); i++){
+        if(threadNames[i].first == id){
+            threadNames[i].second = name;
+            return;
+        }
+    }
+    threadNames.push_back(std::make_pair(id, name));
+}
+
+//writes the events recorded so far in the Trace Event JSON format
+bool Trace::write(std::string fileName)
+{
+    std::ofstream file(fileName.c_str());
+    if(!file)
+        return false;
+
+    std::lock_guard<std::mutex> guard(lock);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for(int i = 0; i < threadNames.size(); i++){
+        file << (first ? "" : ",\n");
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadNames[i].first <<
+                ",\"args\":{\"name\":\"" << escape(threadNames[i].second) << "\"}}";
+        first = false;
+    }
+    for(int i = 0; i < events.size(); i++){
+        Event& e = events[i];
+        file << (first ? "" : ",\n");
+        file << "{\"name\":\"" << escape(e.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread <<
+                ",\"ts\":" << e.start << ",\"dur\":" << e.duration;
+        if(!e.detail.empty())
+            file << ",\"args\":{\"detail\":\"" << escape(e.detail) << "\"}";
+        file << "}";
+        first = false;
+    }
+    file << "\n]}\n";
+
+    return file.good();
+}
+
+double Trace::now(void)
+{
+    std::chrono::duration<double, std::micro> d = std::chrono::steady_clock::now() - origin;
+    return d.count();
+}
+
+//small ids in the order threads first record something
+int Trace::threadId(void)
+{
+    static thread_local int id = nextThread++;
+    return id;
+}
+
+std::string Trace::escape(const std::string& text)
+{
+    std::ostringstream s;
+    for(int i = 0; i < text.size(); i++){
+        char c = text[i];
+        if(c == '"' || c == '\\')
+            s << '\\' << c;
+        else if((unsigned char)c < 0x20)
+            s << ' ';
+        else
+            s << c;
+    }
+    return s.str();
+}
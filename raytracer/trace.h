@@ -0,0 +1,75 @@
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+//timeline of what every thread was doing, written as a Chrome trace
+//that chrome://tracing and Perfetto open directly, recording is off
+//until start is called and costs a flag test per event while off
+class Trace
+{
+    public:
+
+        static void start(void);
+        static void stop(void);
+        static bool isEnabled(void);
+
+        static void begin(const std::string&, const std::string& = "");
+        static void end(void);
+
+        static void setThreadName(const std::string&);
+
+        static bool write(std::string);
+
+    private:
+
+        Trace(void){}
+
+        //a complete event, times in microseconds since start
+        struct Event
+        {
+            std::string name;
+            std::string detail;
+            double start;
+            double duration;
+            int thread;
+        };
+
+        static double now(void);
+        static int threadId(void);
+        static std::string escape(const std::string&);
+
+        static std::atomic<bool> enabled;
+        static std::mutex lock;
+        static std::vector<Event> events;
+        static std::vector<std::pair<int, std::string> > threadNames;
+        static std::atomic<int> nextThread;
+};
+
+//begins an event on construction and ends it when it goes out of scope
+class TraceScope
+{
+    public:
+
+        TraceScope(const std::string& name, const std::string& detail = "")
+        {
+            active = Trace::isEnabled();
+            if(active)
+                Trace::begin(name, detail);
+        }
+
+        ~TraceScope(void)
+        {
+            if(active)
+                Trace::end();
+        }
+
+    private:
+
+        bool active;
+};
+
+#endif // TRACE_H_INCLUDED
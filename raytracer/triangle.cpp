@@ -32,11 +32,15 @@ void Triangle::setNormals(Vector3* n1, Vector3* n2, Vector3* n3)
     smooth = true;
 }
 
-bool Triangle::Intersection(Ray& ray, Hitpoint& h)
+bool Triangle::Intersection(Ray& ray, Hitpoint& h, float tMin, float tMax)
 {
     //compute the intersection time
     float newT = -(Vector3::DotProduct(ray.origin, n) + dist) / Vector3::DotProduct(ray.dir, n);
 
+    //the plane is hit outside the interval, skip the barycentrics
+    if(!(newT > tMin && newT < tMax))
+        return false;
+
     //if t is not infinite
     if(!isinf(newT)){
         //intersection point
@@ -95,6 +99,15 @@ Vector3 Triangle::getNormal(Ray& ray)
         return n;
 }
 
+bool Triangle::getBounds(Vector3& minBound, Vector3& maxBound)
+{
+    for(int k = 0; k < 3; k++){
+        minBound.elements[k] = min(min(p1->elements[k], p2->elements[k]), p3->elements[k]) - Ray::SMALL;
+        maxBound.elements[k] = max(max(p1->elements[k], p2->elements[k]), p3->elements[k]) + Ray::SMALL;
+    }
+    return true;
+}
+
 //the shadow rays are fucking up u and v
 void Triangle::getUV(Vector3& point, Ray& ray, float& U, float& V)
 {
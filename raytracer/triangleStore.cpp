@@ -0,0 +1,416 @@
+#include "triangleStore.h"
+#include "raytracer.h"
+#include "rayStats.h"
+#include <cmath>
+
+#ifdef CPU_SSE
+#include <immintrin.h>
+#endif
+
+TriangleStore::TriangleStore(void)
+{
+    level = CPU::getLevel();
+}
+
+//adds a triangle by its point, normal and texture coordinate indices,
+//the normal and texture coordinate arrays can be NULL
+void TriangleStore::addTriangle(int* vertices, int* normalIds, int* texIds)
+{
+    for(int k = 0; k < 3; k++){
+        vertexIndices.push_back(vertices[k]);
+        normalIndices.push_back(normalIds ? normalIds[k] : -1);
+        texIndices.push_back(texIds ? texIds[k] : -1);
+    }
+}
+
+//copies the vertices into the arrays once all triangles are added
+void TriangleStore::setup(void)
+{
+    int num = size();
+    vector<float>* arrays[9] = {&v0x, &v0y, &v0z, &v1x, &v1y, &v1z, &v2x, &v2y, &v2z};
+    for(int k = 0; k < 9; k++)
+        arrays[k]->assign(num + padding, 0.0f);
+
+    for(int i = 0; i < num; i++){
+        Vector3 p[3];
+        getVertices(i, p[0], p[1], p[2]);
+        for(int k = 0; k < 9; k++)
+            (*arrays[k])[i] = p[k / 3].elements[k % 3];
+    }
+}
+
+//puts the triangles in the given order so ranges of the order are
+//contiguous in memory, order[i] is the old index of triangle i
+void TriangleStore::reorder(const int* order)
+{
+    int num = size();
+    vector<int> vertices(num * 3), normalIds(num * 3), texIds(num * 3);
+    for(int i = 0; i < num; i++){
+        for(int k = 0; k < 3; k++){
+            vertices[i * 3 + k] = vertexIndices[order[i] * 3 + k];
+            normalIds[i * 3 + k] = normalIndices[order[i] * 3 + k];
+            texIds[i * 3 + k] = texIndices[order[i] * 3 + k];
+        }
+    }
+    vertexIndices.swap(vertices);
+    normalIndices.swap(normalIds);
+    texIndices.swap(texIds);
+
+    setup();
+}
+
+//the ray transform of the watertight test by Woop, Benthin and Wald
+void TriangleStore::setupShear(Ray& ray, Shear& shear)
+{
+    Vector3& d = ray.dir;
+    int kz = 0;
+    if(fabs(d.y) > fabs(d.elements[kz]))
+        kz = 1;
+    if(fabs(d.z) > fabs(d.elements[kz]))
+        kz = 2;
+    int kx = (kz + 1) % 3;
+    int ky = (kx + 1) % 3;
+
+    const float* arrays[9] = {&v0x[0], &v0y[0], &v0z[0], &v1x[0], &v1y[0], &v1z[0], &v2x[0], &v2y[0], &v2z[0]};
+    for(int j = 0; j < 3; j++){
+        shear.arrays[j * 3] = arrays[j * 3 + kx];
+        shear.arrays[j * 3 + 1] = arrays[j * 3 + ky];
+        shear.arrays[j * 3 + 2] = arrays[j * 3 + kz];
+    }
+
+    shear.ox = ray.origin.elements[kx];
+    shear.oy = ray.origin.elements[ky];
+    shear.oz = ray.origin.elements[kz];
+    shear.sx = d.elements[kx] / d.elements[kz];
+    shear.sy = d.elements[ky] / d.elements[kz];
+    shear.sz = 1.0f / d.elements[kz];
+}
+
+//watertight test, the edge functions of an edge shared by two triangles
+//are computed from the same numbers and only differ in sign, so a ray
+//through the edge can't slip between them, u and v weight the second
+//and third vertex
+bool TriangleStore::intersect(int i, Shear& s, float& t, float& u, float& v)
+{
+    const float* const* p = s.arrays;
+
+    float az = p[2][i] - s.oz;
+    float bz = p[5][i] - s.oz;
+    float cz = p[8][i] - s.oz;
+    float ax = p[0][i] - s.ox - s.sx * az;
+    float ay = p[1][i] - s.oy - s.sy * az;
+    float bx = p[3][i] - s.ox - s.sx * bz;
+    float by = p[4][i] - s.oy - s.sy * bz;
+    float cx = p[6][i] - s.ox - s.sx * cz;
+    float cy = p[7][i] - s.oy - s.sy * cz;
+
+    float U = cx * by - cy * bx;
+    float V = ax * cy - ay * cx;
+    float W = bx * ay - by * ax;
+
+    //on an edge the float products can round the wrong way
+    if(U == 0.0f || V == 0.0f || W == 0.0f){
+        U = (float)((double)cx * by - (double)cy * bx);
+        V = (float)((double)ax * cy - (double)ay * cx);
+        W = (float)((double)bx * ay - (double)by * ax);
+    }
+
+    if((U < 0.0f || V < 0.0f || W < 0.0f) && (U > 0.0f || V > 0.0f || W > 0.0f))
+        return false;
+
+    float det = U + V + W;
+    if(det == 0.0f)
+        return false;
+    float invDet = 1.0f / det;
+
+    t = (U * az + V * bz + W * cz) * s.sz * invDet;
+    u = V * invDet;
+    v = W * invDet;
+    return true;
+}
+
+//tests the triangles first to first + count
+bool TriangleStore::intersectRange(int first, int count, Ray& ray, Hitpoint& hit)
+{
+    RAY_STATS_ADD(TRIANGLE_TESTS, count);
+#ifdef CPU_AVX2
+    if(level == CPU::AVX2)
+        return intersectAVX2(NULL, first, count, ray, hit);
+#endif
+#ifdef CPU_SSE
+    if(level == CPU::SSE)
+        return intersectSSE(NULL, first, count, ray, hit);
+#endif
+    return intersectScalar(NULL, first, count, ray, hit);
+}
+
+//tests the triangles whose indices are listed
+bool TriangleStore::intersectList(const int* ids, int count, Ray& ray, Hitpoint& hit)
+{
+    RAY_STATS_ADD(TRIANGLE_TESTS, count);
+#ifdef CPU_AVX2
+    if(level == CPU::AVX2)
+        return intersectAVX2(ids, 0, count, ray, hit);
+#endif
+#ifdef CPU_SSE
+    if(level == CPU::SSE)
+        return intersectSSE(ids, 0, count, ray, hit);
+#endif
+    return intersectScalar(ids, 0, count, ray, hit);
+}
+
+bool TriangleStore::intersectScalar(const int* ids, int first, int count, Ray& ray, Hitpoint& hit)
+{
+    Shear shear;
+    setupShear(ray, shear);
+
+    bool found = false;
+    float t, u, v;
+    for(int k = 0; k < count; k++){
+        int i = ids ? ids[k] : first + k;
+        if(intersect(i, shear, t, u, v) && t > Ray::SMALL && t < hit.t){
+            hit.t = t;
+            hit.index = i;
+            hit.f1 = u;
+            hit.f2 = v;
+            found = true;
+        }
+    }
+    return found;
+}
+
+#ifdef CPU_SSE
+//the same test as intersect on four triangles at a time, lanes are
+//scanned in order so ties resolve like the scalar loop, lanes with an
+//edge function of zero are left to the scalar test
+bool TriangleStore::intersectSSE(const int* ids, int first, int count, Ray& ray, Hitpoint& hit)
+{
+    Shear shear;
+    setupShear(ray, shear);
+    const float* const* arrays = shear.arrays;
+
+    __m128 ox = _mm_set1_ps(shear.ox);
+    __m128 oy = _mm_set1_ps(shear.oy);
+    __m128 oz = _mm_set1_ps(shear.oz);
+    __m128 sx = _mm_set1_ps(shear.sx);
+    __m128 sy = _mm_set1_ps(shear.sy);
+    __m128 sz = _mm_set1_ps(shear.sz);
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 small = _mm_set1_ps(Ray::SMALL);
+    __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+
+    bool found = false;
+    for(int k = 0; k < count; k += 4){
+        int n = count - k < 4 ? count - k : 4;
+
+        __m128 a[9];
+        if(ids){
+            int i[4];
+            for(int j = 0; j < 4; j++)
+                i[j] = ids[k + (j < n ? j : 0)];
+            for(int c = 0; c < 9; c++)
+                a[c] = _mm_setr_ps(arrays[c][i[0]], arrays[c][i[1]], arrays[c][i[2]], arrays[c][i[3]]);
+        }
+        else{
+            for(int c = 0; c < 9; c++)
+                a[c] = _mm_loadu_ps(arrays[c] + first + k);
+        }
+
+        __m128 az = _mm_sub_ps(a[2], oz);
+        __m128 bz = _mm_sub_ps(a[5], oz);
+        __m128 cz = _mm_sub_ps(a[8], oz);
+        __m128 ax = _mm_sub_ps(_mm_sub_ps(a[0], ox), _mm_mul_ps(sx, az));
+        __m128 ay = _mm_sub_ps(_mm_sub_ps(a[1], oy), _mm_mul_ps(sy, az));
+        __m128 bx = _mm_sub_ps(_mm_sub_ps(a[3], ox), _mm_mul_ps(sx, bz));
+        __m128 by = _mm_sub_ps(_mm_sub_ps(a[4], oy), _mm_mul_ps(sy, bz));
+        __m128 cx = _mm_sub_ps(_mm_sub_ps(a[6], ox), _mm_mul_ps(sx, cz));
+        __m128 cy = _mm_sub_ps(_mm_sub_ps(a[7], oy), _mm_mul_ps(sy, cz));
+
+        __m128 U = _mm_sub_ps(_mm_mul_ps(cx, by), _mm_mul_ps(cy, bx));
+        __m128 V = _mm_sub_ps(_mm_mul_ps(ax, cy), _mm_mul_ps(ay, cx));
+        __m128 W = _mm_sub_ps(_mm_mul_ps(bx, ay), _mm_mul_ps(by, ax));
+
+        __m128 det = _mm_add_ps(_mm_add_ps(U, V), W);
+        __m128 invDet = _mm_div_ps(one, det);
+        __m128 T = _mm_add_ps(_mm_add_ps(_mm_mul_ps(U, az), _mm_mul_ps(V, bz)), _mm_mul_ps(W, cz));
+        __m128 t = _mm_mul_ps(_mm_mul_ps(T, sz), invDet);
+        __m128 u = _mm_mul_ps(V, invDet);
+        __m128 v = _mm_mul_ps(W, invDet);
+
+        __m128 active = _mm_cmplt_ps(lanes, _mm_set1_ps((float)n));
+        __m128 edge = _mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(U, zero), _mm_cmpeq_ps(V, zero)), _mm_cmpeq_ps(W, zero));
+        __m128 negative = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(U, zero), _mm_cmplt_ps(V, zero)), _mm_cmplt_ps(W, zero));
+        __m128 positive = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(U, zero), _mm_cmpgt_ps(V, zero)), _mm_cmpgt_ps(W, zero));
+
+        __m128 mask = _mm_andnot_ps(edge, active);
+        mask = _mm_andnot_ps(_mm_and_ps(negative, positive), mask);
+        mask = _mm_and_ps(mask, _mm_cmpneq_ps(det, zero));
+        mask = _mm_and_ps(mask, _mm_cmpgt_ps(t, small));
+        mask = _mm_and_ps(mask, _mm_cmplt_ps(t, _mm_set1_ps(hit.t)));
+
+        int bits = _mm_movemask_ps(mask);
+        int edgeBits = _mm_movemask_ps(_mm_and_ps(edge, active));
+        if(bits == 0 && edgeBits == 0)
+            continue;
+
+        float tl[4], ul[4], vl[4];
+        _mm_storeu_ps(tl, t);
+        _mm_storeu_ps(ul, u);
+        _mm_storeu_ps(vl, v);
+        for(int j = 0; j < n; j++){
+            int i = ids ? ids[k + j] : first + k + j;
+            if((edgeBits & (1 << j)) && intersect(i, shear, tl[j], ul[j], vl[j]) && tl[j] > Ray::SMALL)
+                bits |= 1 << j;
+            if((bits & (1 << j)) && tl[j] < hit.t){
+                hit.t = tl[j];
+                hit.index = i;
+                hit.f1 = ul[j];
+                hit.f2 = vl[j];
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+#endif
+
+#ifdef CPU_AVX2
+//eight wide version of intersectSSE, the listed triangles are gathered
+TARGET_AVX2 bool TriangleStore::intersectAVX2(const int* ids, int first, int count, Ray& ray, Hitpoint& hit)
+{
+    Shear shear;
+    setupShear(ray, shear);
+    const float* const* arrays = shear.arrays;
+
+    __m256 ox = _mm256_set1_ps(shear.ox);
+    __m256 oy = _mm256_set1_ps(shear.oy);
+    __m256 oz = _mm256_set1_ps(shear.oz);
+    __m256 sx = _mm256_set1_ps(shear.sx);
+    __m256 sy = _mm256_set1_ps(shear.sy);
+    __m256 sz = _mm256_set1_ps(shear.sz);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 small = _mm256_set1_ps(Ray::SMALL);
+    __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+
+    bool found = false;
+    for(int k = 0; k < count; k += 8){
+        int n = count - k < 8 ? count - k : 8;
+
+        __m256 a[9];
+        if(ids){
+            int i[8];
+            for(int j = 0; j < 8; j++)
+                i[j] = ids[k + (j < n ? j : 0)];
+            __m256i index = _mm256_loadu_si256((const __m256i*)i);
+            for(int c = 0; c < 9; c++)
+                a[c] = _mm256_i32gather_ps(arrays[c], index, 4);
+        }
+        else{
+            for(int c = 0; c < 9; c++)
+                a[c] = _mm256_loadu_ps(arrays[c] + first + k);
+        }
+
+        __m256 az = _mm256_sub_ps(a[2], oz);
+        __m256 bz = _mm256_sub_ps(a[5], oz);
+        __m256 cz = _mm256_sub_ps(a[8], oz);
+        __m256 ax = _mm256_sub_ps(_mm256_sub_ps(a[0], ox), _mm256_mul_ps(sx, az));
+        __m256 ay = _mm256_sub_ps(_mm256_sub_ps(a[1], oy), _mm256_mul_ps(sy, az));
+        __m256 bx = _mm256_sub_ps(_mm256_sub_ps(a[3], ox), _mm256_mul_ps(sx, bz));
+        __m256 by = _mm256_sub_ps(_mm256_sub_ps(a[4], oy), _mm256_mul_ps(sy, bz));
+        __m256 cx = _mm256_sub_ps(_mm256_sub_ps(a[6], ox), _mm256_mul_ps(sx, cz));
+        __m256 cy = _mm256_sub_ps(_mm256_sub_ps(a[7], oy), _mm256_mul_ps(sy, cz));
+
+        __m256 U = _mm256_sub_ps(_mm256_mul_ps(cx, by), _mm256_mul_ps(cy, bx));
+        __m256 V = _mm256_sub_ps(_mm256_mul_ps(ax, cy), _mm256_mul_ps(ay, cx));
+        __m256 W = _mm256_sub_ps(_mm256_mul_ps(bx, ay), _mm256_mul_ps(by, ax));
+
+        __m256 det = _mm256_add_ps(_mm256_add_ps(U, V), W);
+        __m256 invDet = _mm256_div_ps(one, det);
+        __m256 T = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(U, az), _mm256_mul_ps(V, bz)), _mm256_mul_ps(W, cz));
+        __m256 t = _mm256_mul_ps(_mm256_mul_ps(T, sz), invDet);
+        __m256 u = _mm256_mul_ps(V, invDet);
+        __m256 v = _mm256_mul_ps(W, invDet);
+
+        __m256 active = _mm256_cmp_ps(lanes, _mm256_set1_ps((float)n), _CMP_LT_OQ);
+        __m256 edge = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(U, zero, _CMP_EQ_OQ), _mm256_cmp_ps(V, zero, _CMP_EQ_OQ)), _mm256_cmp_ps(W, zero, _CMP_EQ_OQ));
+        __m256 negative = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(U, zero, _CMP_LT_OQ), _mm256_cmp_ps(V, zero, _CMP_LT_OQ)), _mm256_cmp_ps(W, zero, _CMP_LT_OQ));
+        __m256 positive = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(U, zero, _CMP_GT_OQ), _mm256_cmp_ps(V, zero, _CMP_GT_OQ)), _mm256_cmp_ps(W, zero, _CMP_GT_OQ));
+
+        __m256 mask = _mm256_andnot_ps(edge, active);
+        mask = _mm256_andnot_ps(_mm256_and_ps(negative, positive), mask);
+        mask = _mm256_and_ps(mask, _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ));
+        mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, small, _CMP_GT_OQ));
+        mask = _mm256_and_ps(mask, _mm256_cmp_ps(t, _mm256_set1_ps(hit.t), _CMP_LT_OQ));
+
+        int bits = _mm256_movemask_ps(mask);
+        int edgeBits = _mm256_movemask_ps(_mm256_and_ps(edge, active));
+        if(bits == 0 && edgeBits == 0)
+            continue;
+
+        float tl[8], ul[8], vl[8];
+        _mm256_storeu_ps(tl, t);
+        _mm256_storeu_ps(ul, u);
+        _mm256_storeu_ps(vl, v);
+        for(int j = 0; j < n; j++){
+            int i = ids ? ids[k + j] : first + k + j;
+            if((edgeBits & (1 << j)) && intersect(i, shear, tl[j], ul[j], vl[j]) && tl[j] > Ray::SMALL)
+                bits |= 1 << j;
+            if((bits & (1 << j)) && tl[j] < hit.t){
+                hit.t = tl[j];
+                hit.index = i;
+                hit.f1 = ul[j];
+                hit.f2 = vl[j];
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+#endif
+
+//interpolated normal when the OBJ has normals, the planar normal otherwise
+Vector3 TriangleStore::getNormal(int i, float u, float v)
+{
+    int* n = &normalIndices[i * 3];
+    if(n[0] >= 0 && n[1] >= 0 && n[2] >= 0)
+        return (1 - u - v) * normals[n[0]] + u * normals[n[1]] + v * normals[n[2]];
+
+    Vector3 e1(v1x[i] - v0x[i], v1y[i] - v0y[i], v1z[i] - v0z[i]);
+    Vector3 e2(v2x[i] - v0x[i], v2y[i] - v0y[i], v2z[i] - v0z[i]);
+    Vector3 planar = Vector3::CrossProduct(e2, e1);
+    planar.normalize();
+    return planar;
+}
+
+void TriangleStore::getUV(int i, float u, float v, float& U, float& V)
+{
+    int* tc = &texIndices[i * 3];
+    if(tc[0] < 0 || tc[1] < 0 || tc[2] < 0){
+        U = 0.0f;
+        V = 0.0f;
+        return;
+    }
+
+    U = (1 - u - v) * texCoords[tc[0]].x + u * texCoords[tc[1]].x + v * texCoords[tc[2]].x;
+    V = (1 - u - v) * texCoords[tc[0]].y + u * texCoords[tc[1]].y + v * texCoords[tc[2]].y;
+}
+
+void TriangleStore::getVertices(int i, Vector3& p1, Vector3& p2, Vector3& p3)
+{
+    p1 = points[vertexIndices[i * 3]];
+    p2 = points[vertexIndices[i * 3 + 1]];
+    p3 = points[vertexIndices[i * 3 + 2]];
+}
+
+int TriangleStore::size(void)
+{
+    return vertexIndices.size() / 3;
+}
+
+size_t TriangleStore::getMemoryUsage(void)
+{
+    return (size() + padding) * 9 * sizeof(float) + size() * 9 * sizeof(int) +
+           (points.size() + normals.size() + texCoords.size()) * sizeof(Vector3);
+}
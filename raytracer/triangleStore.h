@@ -0,0 +1,84 @@
+#ifndef TRIANGLESTORE_H_INCLUDED
+#define TRIANGLESTORE_H_INCLUDED
+
+#include <vector>
+#include "vector.h"
+#include "ray.h"
+#include "cpu.h"
+
+using namespace std;
+
+struct Hitpoint;
+
+//the triangles of a mesh stored as arrays instead of one Shape per face,
+//the vertices used by the intersection test are kept apart from the shading data
+class TriangleStore
+{
+    public:
+
+        TriangleStore(void);
+
+        void addTriangle(int*, int*, int*);
+        void setup(void);
+        void reorder(const int*);
+
+        //closest hit among several triangles, only hits nearer
+        //than hit.t are accepted
+        bool intersectRange(int, int, Ray&, Hitpoint&);
+        bool intersectList(const int*, int, Ray&, Hitpoint&);
+
+        Vector3 getNormal(int, float, float);
+        void getUV(int, float, float, float&, float&);
+        void getVertices(int, Vector3&, Vector3&, Vector3&);
+
+        int size(void);
+        size_t getMemoryUsage(void);
+
+        //shared vertex data filled by the OBJ loader
+        vector<Vector3> points;
+        vector<Vector3> normals;
+        vector<Vector3> texCoords;
+
+    private:
+
+        //per ray data of the watertight test, the axes are permuted so the
+        //ray runs along its largest axis z and the triangles are sheared
+        //until it points straight down z, arrays holds the vertex arrays in
+        //that order and o the permuted origin
+        struct Shear
+        {
+            const float* arrays[9];
+            float ox, oy, oz;
+            float sx, sy, sz;
+        };
+
+        void setupShear(Ray&, Shear&);
+        bool intersect(int, Shear&, float&, float&, float&);
+
+        bool intersectScalar(const int*, int, int, Ray&, Hitpoint&);
+#ifdef CPU_SSE
+        bool intersectSSE(const int*, int, int, Ray&, Hitpoint&);
+#endif
+#ifdef CPU_AVX2
+        TARGET_AVX2 bool intersectAVX2(const int*, int, int, Ray&, Hitpoint&);
+#endif
+
+        CPU::Level level;
+
+        //the arrays are padded so the wide kernels can always load a full
+        //vector past the last triangle
+        static const int padding = 8;
+
+        //the three vertices per triangle, they are copied as they are so
+        //triangles sharing an edge test it with the very same numbers
+        vector<float> v0x, v0y, v0z;
+        vector<float> v1x, v1y, v1z;
+        vector<float> v2x, v2y, v2z;
+
+        //three entries per triangle, -1 when the attribute is missing
+        vector<int> vertexIndices;
+        vector<int> normalIndices;
+        vector<int> texIndices;
+};
+
+#endif // TRIANGLESTORE_H_INCLUDED